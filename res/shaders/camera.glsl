@@ -0,0 +1,20 @@
+// `Application::CameraData`, set 0 binding 0 of every pipeline. view space is x right, y down, z forward
+
+#define MAX_VIEWS 4
+#define MAX_CASCADES 4
+
+layout(set = 0, binding = 0) uniform CameraData {
+    vec3 position;
+    mat4 viewProjection[MAX_VIEWS]; // indexed with `gl_ViewIndex`
+    mat4 view[MAX_VIEWS];
+    mat4 inverseView[MAX_VIEWS];
+    mat4 projection; // shared by all views
+    mat4 inverseProjection;
+    vec2 viewportSize; // of one view, in pixels
+    float zNear;
+    float zFar;
+    mat4 cascadeViewProjection[MAX_CASCADES]; // `cascades::COUNT`
+    vec4 cascadeSplits; // view space depth where each cascade ends
+    vec3 sunDirection; // where the light travels, world space
+    vec3 sunColor;
+} cameraData;
@@ -0,0 +1,58 @@
+// clustered lighting, `clusters` in render/Clusters.hpp. needs camera.glsl
+
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define MAX_LIGHTS 1024
+#define MAX_LIGHTS_PER_CLUSTER 32
+// `clusters::Grid`, one per view: light counts of every cluster, then `MAX_LIGHTS_PER_CLUSTER` indices per cluster
+#define CLUSTER_GRID_SIZE (CLUSTER_COUNT + CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER)
+
+struct PointLight {
+    vec3 position; // world space
+    float radius;
+    vec3 color;
+    float intensity;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Lights {
+    uint lightCount;
+    PointLight lights[];
+};
+
+// only cluster_cull.comp writes the grid
+#ifndef CLUSTERS_WRITABLE
+readonly
+#endif
+layout(std430, set = 0, binding = 2) buffer Clusters {
+    uint clusterData[];
+};
+
+const vec3 AMBIENT = vec3(0.1);
+
+float clusterSliceDepth(uint slice) {
+    return cameraData.zNear * pow(cameraData.zFar / cameraData.zNear, float(slice) / float(CLUSTER_Z));
+}
+uint clusterIndex(vec2 fragCoord, float viewZ) {
+    uvec2 tile = uvec2(clamp(fragCoord / cameraData.viewportSize * vec2(CLUSTER_X, CLUSTER_Y), vec2(0.0), vec2(CLUSTER_X - 1, CLUSTER_Y - 1)));
+    float slice = log(viewZ / cameraData.zNear) / log(cameraData.zFar / cameraData.zNear) * float(CLUSTER_Z);
+    return (uint(clamp(slice, 0.0, float(CLUSTER_Z - 1))) * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x;
+}
+
+// diffuse lighting from the lights of the cluster `viewPosition` is in, everything in view space
+vec3 shadeClustered(vec3 albedo, vec3 viewPosition, vec3 viewNormal, vec2 fragCoord, uint viewIndex) {
+    uint grid = viewIndex * CLUSTER_GRID_SIZE;
+    uint cluster = clusterIndex(fragCoord, viewPosition.z);
+    uint count = clusterData[grid + cluster];
+
+    vec3 light = AMBIENT;
+    for(uint i = 0; i < count; i++) {
+        PointLight l = lights[clusterData[grid + CLUSTER_COUNT + cluster * MAX_LIGHTS_PER_CLUSTER + i]];
+        vec3 toLight = (cameraData.view[viewIndex] * vec4(l.position, 1.0)).xyz - viewPosition;
+        float distance = length(toLight);
+        float falloff = clamp(1.0 - distance / l.radius, 0.0, 1.0);
+        light += l.color * l.intensity * falloff * falloff * max(dot(viewNormal, toLight / max(distance, 1e-4)), 0.0);
+    }
+    return albedo * light;
+}
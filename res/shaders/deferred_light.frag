@@ -0,0 +1,31 @@
+#version 450
+#extension GL_EXT_multiview : require
+
+// `GBuffer` attachments, written by the geometry subpass at this very pixel
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput albedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput normal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput depth;
+
+layout(location = 0) out vec4 color;
+
+#include "camera.glsl"
+#include "clusters.glsl"
+#include "shadows.glsl"
+
+void main() {
+    // nothing was drawn here, keep the clear color
+    float d = subpassLoad(depth).r;
+    if(d == 1.0)
+        discard;
+
+    // back from depth to view space, the pass renders at `viewportSize`
+    vec2 ndc = gl_FragCoord.xy / cameraData.viewportSize * 2.0 - 1.0;
+    vec4 viewPosition = cameraData.inverseProjection * vec4(ndc, d, 1.0);
+    viewPosition /= viewPosition.w;
+
+    vec3 worldNormal = normalize(subpassLoad(normal).xyz * 2.0 - 1.0);
+    vec3 worldPosition = (cameraData.inverseView[gl_ViewIndex] * viewPosition).xyz;
+    vec3 viewNormal = mat3(cameraData.view[gl_ViewIndex]) * worldNormal;
+    vec3 a = subpassLoad(albedo).rgb;
+    color = vec4(shadeClustered(a, viewPosition.xyz, viewNormal, gl_FragCoord.xy, gl_ViewIndex) + shadeSun(a, worldPosition, worldNormal, viewPosition.z), 1.0);
+}
@@ -0,0 +1,22 @@
+#version 450
+
+// replaces triangle.frag in the geometry subpass of deferred shading, same interface so they share a layout
+
+// `ShaderFeature` bits, specialized per pipeline variant
+layout(constant_id = 0) const bool VERTEX_COLOR = true;
+layout(constant_id = 3) const bool ALPHA_TEST = false;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normal;
+
+#include "camera.glsl"
+
+void main() {
+    albedo = VERTEX_COLOR ? vec4(fragColor, 1.0) : vec4(1.0);
+    if(ALPHA_TEST && albedo.a < 0.5)
+        discard;
+    normal = vec4(normalize(fragNormal) * 0.5 + 0.5, 0.0);
+}
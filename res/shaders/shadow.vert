@@ -0,0 +1,13 @@
+#version 450
+
+// shadow casters, `ShadowCascades`. positions only, the matrix takes them straight to the cascade's clip space
+
+layout(location = 0) in vec2 position;
+
+layout(push_constant) uniform Constants {
+    mat4 transformMatrix; // cascade view projection * model
+} constants;
+
+void main() {
+    gl_Position = constants.transformMatrix * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,23 @@
+// sun light with cascaded shadows, `ShadowCascades` in render/ShadowCascades.hpp. needs camera.glsl
+
+layout(set = 0, binding = 3) uniform sampler2DShadow shadowAtlas;
+
+// 1 where the sun reaches `worldPosition`, `viewZ` picks the cascade
+float sunShadow(vec3 worldPosition, float viewZ) {
+    if(viewZ > cameraData.cascadeSplits[MAX_CASCADES - 1])
+        return 1.0; // past the shadow distance
+    uint c = 0;
+    while(c < MAX_CASCADES - 1 && viewZ > cameraData.cascadeSplits[c])
+        c++;
+
+    vec4 clip = cameraData.cascadeViewProjection[c] * vec4(worldPosition, 1.0);
+    // cascades are laid out 2x2, keep the filter from reaching into the neighbouring one
+    vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 uv = clamp((clip.xy * 0.5 + 0.5) * 0.5, texel, 0.5 - texel) + vec2(c % 2, c / 2) * 0.5;
+    return texture(shadowAtlas, vec3(uv, clip.z));
+}
+
+vec3 shadeSun(vec3 albedo, vec3 worldPosition, vec3 worldNormal, float viewZ) {
+    float diffuse = max(dot(worldNormal, -cameraData.sunDirection), 0.0);
+    return albedo * cameraData.sunColor * diffuse * sunShadow(worldPosition, viewZ);
+}
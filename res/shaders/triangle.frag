@@ -1,14 +1,27 @@
 #version 450
+#extension GL_EXT_multiview : require
+
+// `ShaderFeature` bits, specialized per pipeline variant
+layout(constant_id = 0) const bool VERTEX_COLOR = true;
+layout(constant_id = 3) const bool ALPHA_TEST = false;
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec3 fragWorldPosition;
 
 layout(location = 0) out vec4 color;
 
-layout(set = 0, binding = 0) uniform CameraData {
-    vec3 position;
-} cameraData;
+#include "camera.glsl"
+#include "clusters.glsl"
+#include "shadows.glsl"
 
 void main() {
-    color = vec4(fragColor, 1.0);
-//    color = vec4(cameraData.position, 1.0);
+    color = VERTEX_COLOR ? vec4(fragColor, 1.0) : vec4(1.0);
+    if(ALPHA_TEST && color.a < 0.5)
+        discard;
+
+    vec3 viewPosition = (cameraData.view[gl_ViewIndex] * vec4(fragWorldPosition, 1.0)).xyz;
+    vec3 viewNormal = mat3(cameraData.view[gl_ViewIndex]) * normalize(fragNormal);
+    color.rgb = shadeClustered(color.rgb, viewPosition, viewNormal, gl_FragCoord.xy, gl_ViewIndex)
+        + shadeSun(color.rgb, fragWorldPosition, normalize(fragNormal), viewPosition.z);
 }
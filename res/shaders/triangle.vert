@@ -1,15 +1,24 @@
 #version 450
+#extension GL_EXT_multiview : require
+
+#include "camera.glsl"
 
 layout(location = 0) in vec2 position;
 layout(location = 1) in vec3 color;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal; // world space
+layout(location = 2) out vec3 fragWorldPosition;
 
 layout(push_constant) uniform Constants {
     mat4 transformMatrix;
 } constants;
 
 void main() {
-    gl_Position = constants.transformMatrix * vec4(position, 0.0, 1.0);
+    // without multiview `gl_ViewIndex` is always 0
+    vec4 worldPosition = constants.transformMatrix * vec4(position, 0.0, 1.0);
+    gl_Position = cameraData.viewProjection[gl_ViewIndex] * worldPosition;
+    fragWorldPosition = worldPosition.xyz;
     fragColor = color;
+    fragNormal = mat3(constants.transformMatrix) * vec3(0.0, 0.0, -1.0); // flat geometry facing the camera
 }
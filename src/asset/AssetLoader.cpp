@@ -0,0 +1,166 @@
+#include "AssetLoader.hpp"
+
+#include <util/AsyncLog.hpp>
+
+#include <chrono>
+#include <cstring>
+
+void AssetLoader::create(vk::Device device, vma::Allocator allocator, vma::Pool stagingPool, vk::Queue transferQueue, uint32_t transferQueueFamily, std::mutex *transferQueueMutex, const AssetPack *pack, uint32_t workerCount) {
+	this->device = device;
+	this->allocator = allocator;
+	this->stagingPool = stagingPool;
+	this->transferQueue = transferQueue;
+	this->transferQueueMutex = transferQueueMutex;
+	this->pack = pack;
+
+	commandPool = device.createCommandPool(vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, transferQueueFamily));
+
+	workers.create(workerCount);
+	io.create();
+
+	stopping = false;
+	thread = std::thread(&AssetLoader::run, this);
+}
+void AssetLoader::destroy() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_one();
+	thread.join();
+
+	workers.destroy();
+	io.destroy();
+	device.destroyCommandPool(commandPool);
+}
+
+void AssetLoader::ReadAwaiter::await_suspend(std::coroutine_handle<> handle) {
+	// once the read is queued this awaiter may be resumed and gone at any moment, don't touch it after that
+	AssetLoader *l = loader;
+	read.callback = [this, handle](int64_t r) {
+		result = r;
+		loader->workers.post([handle]() {
+			handle.resume();
+		});
+	};
+	{
+		std::lock_guard<std::mutex> lock(l->mutex);
+		l->newReads.push_back(std::move(read));
+	}
+	l->changed.notify_one();
+}
+void AssetLoader::FenceAwaiter::await_suspend(std::coroutine_handle<> handle) {
+	AssetLoader *l = loader;
+	{
+		std::lock_guard<std::mutex> lock(l->mutex);
+		l->fences.push_back({fence, handle});
+	}
+	l->changed.notify_one();
+}
+
+void AssetLoader::run() {
+	std::vector<AsyncIO::Read> reads;
+	std::vector<PendingFence> waiting;
+
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			auto hasWork = [&]() {
+				return stopping || !newReads.empty() || !fences.empty();
+			};
+			// sleep while idle, poll reads and fences while anything is in flight
+			if(io.inFlight == 0 && waiting.empty())
+				changed.wait(lock, hasWork);
+			else
+				changed.wait_for(lock, std::chrono::microseconds(200), hasWork);
+
+			if(stopping && newReads.empty() && fences.empty() && io.inFlight == 0 && waiting.empty())
+				return;
+
+			reads.swap(newReads);
+			waiting.insert(waiting.end(), fences.begin(), fences.end());
+			fences.clear();
+		}
+
+		if(!reads.empty()) {
+			io.submit(reads.data(), reads.size());
+			reads.clear();
+		}
+		io.poll();
+
+		for(size_t i = 0; i < waiting.size();) {
+			if(device.getFenceStatus(waiting[i].fence) != vk::Result::eSuccess) {
+				i++;
+				continue;
+			}
+			std::coroutine_handle<> handle = waiting[i].handle;
+			workers.post([handle]() {
+				handle.resume();
+			});
+			waiting[i] = waiting.back();
+			waiting.pop_back();
+		}
+	}
+}
+
+Task<std::vector<uint8_t>> AssetLoader::readEntry(const char *name) {
+	const AssetPack::Entry *entry = pack->find(name);
+	if(!entry)
+		asynclog::exitError("%s isn't in the asset pack :(", name);
+
+	std::vector<uint8_t> stored(entry->storedSize);
+	int64_t result = co_await read(pack->fd, entry->offset, stored.data(), stored.size());
+	if(result != (int64_t) stored.size())
+		asynclog::exitError("Failed to read %s (%lld) :(", name, (long long) result);
+
+	if(entry->chunkCount == 0)
+		co_return stored;
+
+	co_await resumeOnWorker();
+	std::vector<uint8_t> decoded;
+	if(!AssetPack::decompress(*entry, stored.data(), decoded, &workers))
+		asynclog::exitError("%s is corrupt :(", name);
+	co_return decoded;
+}
+
+Task<void> AssetLoader::upload(vk::Buffer buffer, vk::DeviceSize offset, const void *data, vk::DeviceSize size) {
+	vk::Buffer staging;
+	vma::Allocation stagingAllocation;
+	std::tie(staging, stagingAllocation) = allocator.createBuffer(
+		vk::BufferCreateInfo(vk::BufferCreateFlags(), size, vk::BufferUsageFlagBits::eTransferSrc),
+		vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eUnknown,
+			vk::MemoryPropertyFlags(), vk::MemoryPropertyFlags(), 0, stagingPool
+		)
+	);
+
+	void *mapped;
+	allocator.mapMemory(stagingAllocation, &mapped);
+	memcpy(mapped, data, size);
+	allocator.flushAllocation(stagingAllocation, 0, size);
+	allocator.unmapMemory(stagingAllocation);
+
+	vk::CommandBuffer commandBuffer;
+	{
+		// recording also needs the pool to be externally synchronized
+		std::lock_guard<std::mutex> lock(commandPoolMutex);
+		commandBuffer = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr));
+		commandBuffer.copyBuffer(staging, buffer, vk::BufferCopy(0, offset, size));
+		commandBuffer.end();
+	}
+
+	vk::Fence fence = device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlags()));
+	{
+		std::lock_guard<std::mutex> lock(*transferQueueMutex);
+		transferQueue.submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &commandBuffer, 0, nullptr), fence);
+	}
+
+	co_await signaled(fence);
+
+	device.destroyFence(fence);
+	{
+		std::lock_guard<std::mutex> lock(commandPoolMutex);
+		device.freeCommandBuffers(commandPool, commandBuffer);
+	}
+	allocator.destroyBuffer(staging, stagingAllocation);
+}
@@ -0,0 +1,115 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <asset/AssetPack.hpp>
+#include <asset/AsyncIO.hpp>
+#include <util/Task.hpp>
+#include <util/ThreadPool.hpp>
+
+#include <condition_variable>
+#include <coroutine>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Awaitables for writing asset loads as `Task` coroutines, e.g.
+///
+///     std::vector<uint8_t> data = co_await loader.readEntry("meshes/foo.bin"); // async read, no thread blocks
+///     co_await loader.resumeOnWorker(); // decode on the worker pool
+///     co_await loader.upload(buffer, offset, decoded.data(), decoded.size()); // transfer queue + fence
+///
+/// Reads and fences are driven by one loader thread; whatever was waiting on them continues on the worker pool.
+class AssetLoader {
+public:
+	struct WorkerAwaiter {
+		AssetLoader *loader;
+
+		bool await_ready() const noexcept {
+			return false;
+		}
+		void await_suspend(std::coroutine_handle<> handle) {
+			loader->workers.post([handle]() {
+				handle.resume();
+			});
+		}
+		void await_resume() const noexcept {}
+	};
+	struct ReadAwaiter {
+		AssetLoader *loader;
+		AsyncIO::Read read;
+		int64_t result;
+
+		bool await_ready() const noexcept {
+			return false;
+		}
+		void await_suspend(std::coroutine_handle<> handle);
+		int64_t await_resume() const noexcept {
+			return result;
+		}
+	};
+	struct FenceAwaiter {
+		AssetLoader *loader;
+		vk::Fence fence;
+
+		bool await_ready() const noexcept {
+			return false;
+		}
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept {}
+	};
+
+	vk::Device device;
+	vma::Allocator allocator;
+	vma::Pool stagingPool;
+	vk::Queue transferQueue;
+	std::mutex *transferQueueMutex; // shared with everything else submitting to `transferQueue`
+	const AssetPack *pack;
+
+	ThreadPool workers;
+	AsyncIO io; // only touched by the loader thread
+protected:
+	struct PendingFence {
+		vk::Fence fence;
+		std::coroutine_handle<> handle;
+	};
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<AsyncIO::Read> newReads;
+	std::vector<PendingFence> fences;
+	bool stopping;
+
+	vk::CommandPool commandPool;
+	std::mutex commandPoolMutex;
+public:
+	void create(vk::Device device, vma::Allocator allocator, vma::Pool stagingPool, vk::Queue transferQueue, uint32_t transferQueueFamily, std::mutex *transferQueueMutex, const AssetPack *pack, uint32_t workerCount);
+	/// waits for outstanding reads and uploads
+	void destroy();
+
+	/// continue on the worker pool
+	WorkerAwaiter resumeOnWorker() {
+		return {this};
+	}
+	/// bytes read or `-errno`. `buffer` can be mapped staging memory
+	ReadAwaiter read(int fd, uint64_t offset, void *buffer, size_t size) {
+		return {this, {fd, offset, buffer, size, nullptr}, 0};
+	}
+	/// continue on the worker pool once `fence` is signaled
+	FenceAwaiter signaled(vk::Fence fence) {
+		return {this, fence};
+	}
+
+	/// reads a pack entry through `io` and decompresses it on the workers if needed
+	Task<std::vector<uint8_t>> readEntry(const char *name);
+	/// copies `size` bytes to `buffer` through a staging buffer on the transfer queue. `data` has to stay
+	/// valid until the task is done
+	Task<void> upload(vk::Buffer buffer, vk::DeviceSize offset, const void *data, vk::DeviceSize size);
+protected:
+	void run();
+};
+
+#endif //ASSETLOADER_HPP
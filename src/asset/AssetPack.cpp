@@ -0,0 +1,171 @@
+#include "AssetPack.hpp"
+
+#include <util/Lz4.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool AssetPack::open(const char *path) {
+	int fd = ::open(path, O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+		::close(fd);
+		return false;
+	}
+	void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(mapping == MAP_FAILED) {
+		::close(fd);
+		return false;
+	}
+	this->fd = fd;
+
+	data = static_cast<const uint8_t*>(mapping);
+	size = st.st_size;
+	header = reinterpret_cast<const Header*>(data);
+
+	if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+	|| header->indexOffset % alignof(Entry) != 0
+	|| header->indexOffset > size || header->entryCount > (size - header->indexOffset) / sizeof(Entry)
+	|| header->namesOffset > size || header->namesSize > size - header->namesOffset
+	|| header->namesSize == 0 || data[header->namesOffset + header->namesSize - 1] != '\0') {
+		close();
+		return false;
+	}
+	entries = reinterpret_cast<const Entry*>(data + header->indexOffset);
+	names = reinterpret_cast<const char*>(data + header->namesOffset);
+
+	for(uint32_t i = 0; i < header->entryCount; i++) {
+		const Entry &e = entries[i];
+		if(e.offset > size || e.storedSize > size - e.offset || e.nameOffset >= header->namesSize
+		|| (e.chunkCount == 0 && e.storedSize != e.size)
+		|| (e.chunkCount != 0 && e.chunkCount != (e.size + CHUNK_SIZE - 1) / CHUNK_SIZE)) {
+			close();
+			return false;
+		}
+	}
+
+	// the whole pack is usually read front to back while loading
+	madvise(mapping, size, MADV_WILLNEED);
+	return true;
+}
+void AssetPack::close() {
+	if(data)
+		munmap(const_cast<uint8_t*>(data), size);
+	if(fd >= 0)
+		::close(fd);
+	fd = -1;
+	data = nullptr;
+	size = 0;
+	header = nullptr;
+	entries = nullptr;
+	names = nullptr;
+}
+
+const AssetPack::Entry *AssetPack::find(const char *name) const {
+	if(!header)
+		return nullptr;
+
+	uint64_t h = hash(name);
+	const Entry *end = entries + header->entryCount;
+	const Entry *e = std::lower_bound(entries, end, h, [](const Entry &entry, uint64_t h) {
+		return entry.hash < h;
+	});
+	for(; e != end && e->hash == h; e++) // hash collisions end up next to each other
+		if(strcmp(this->name(*e), name) == 0)
+			return e;
+	return nullptr;
+}
+AssetPack::Span AssetPack::view(const char *name) const {
+	const Entry *e = find(name);
+	if(!e || e->chunkCount != 0)
+		return {nullptr, 0};
+	return {data + e->offset, e->size};
+}
+bool AssetPack::read(const char *name, std::vector<uint8_t> &out, ThreadPool *workers) const {
+	const Entry *e = find(name);
+	if(!e)
+		return false;
+	return decompress(*e, data + e->offset, out, workers);
+}
+bool AssetPack::decompress(const Entry &entry, const uint8_t *stored, std::vector<uint8_t> &out, ThreadPool *workers) {
+	out.resize(entry.size);
+	if(entry.chunkCount == 0) {
+		memcpy(out.data(), stored, entry.size);
+		return true;
+	}
+
+	if(entry.storedSize < entry.chunkCount * sizeof(uint32_t))
+		return false;
+
+	// prefix sum of the chunk table so every chunk can be decoded on its own
+	std::vector<uint64_t> chunkOffsets(entry.chunkCount + 1);
+	chunkOffsets[0] = entry.chunkCount * sizeof(uint32_t);
+	for(uint32_t c = 0; c < entry.chunkCount; c++) {
+		uint32_t chunkSize;
+		memcpy(&chunkSize, stored + c * sizeof(uint32_t), sizeof(uint32_t));
+		chunkOffsets[c + 1] = chunkOffsets[c] + chunkSize;
+	}
+	if(chunkOffsets[entry.chunkCount] > entry.storedSize)
+		return false;
+
+	// shared with the helpers, one may only get to run after everything is decoded and this call has returned
+	struct Decode {
+		const uint8_t *stored;
+		uint8_t *out;
+		uint64_t size;
+		std::vector<uint64_t> chunkOffsets;
+		uint32_t chunkCount;
+
+		std::atomic<uint32_t> nextChunk{0};
+		std::atomic<bool> ok{true};
+		uint32_t doneChunks = 0;
+		std::mutex doneMutex;
+		std::condition_variable chunksDone;
+
+		void run() {
+			for(uint32_t c; (c = nextChunk.fetch_add(1)) < chunkCount;) {
+				size_t outOffset = (size_t) c * CHUNK_SIZE;
+				size_t outSize = std::min<size_t>(CHUNK_SIZE, size - outOffset);
+				if(!lz4::decompress(stored + chunkOffsets[c], chunkOffsets[c + 1] - chunkOffsets[c], out + outOffset, outSize))
+					ok = false;
+				std::lock_guard<std::mutex> lock(doneMutex);
+				if(++doneChunks == chunkCount)
+					chunksDone.notify_all();
+			}
+		}
+	};
+	std::shared_ptr<Decode> decode = std::make_shared<Decode>();
+	decode->stored = stored;
+	decode->out = out.data();
+	decode->size = entry.size;
+	decode->chunkOffsets = std::move(chunkOffsets);
+	decode->chunkCount = entry.chunkCount;
+
+	uint32_t helpers = workers ? std::min<size_t>(workers->threads.size(), entry.chunkCount - 1) : 0;
+	for(uint32_t i = 0; i < helpers; i++)
+		workers->post([decode]() {
+			decode->run();
+		});
+	decode->run();
+
+	// chunks other threads claimed are being decoded right now, so this never waits on a job stuck in the queue
+	std::unique_lock<std::mutex> lock(decode->doneMutex);
+	decode->chunksDone.wait(lock, [&]() {
+		return decode->doneChunks == entry.chunkCount;
+	});
+
+	bool ok = decode->ok;
+	return ok;
+}
@@ -0,0 +1,85 @@
+#ifndef ASSETPACK_HPP
+#define ASSETPACK_HPP
+
+#include <util/ThreadPool.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Read-only archive of everything under `res/`, written by the `AssetPacker` target at build time.
+///
+/// Layout: a `Header`, the blobs (each aligned to `ALIGNMENT`), then the `Entry` index sorted by name
+/// hash and the zero terminated names. The file is mapped once and uncompressed entries are handed out as
+/// views straight into the mapping. Compressed entries are cut into `CHUNK_SIZE` pieces, each its own LZ4
+/// block, stored as a table of compressed chunk sizes followed by the chunks so they decode in parallel.
+class AssetPack {
+public:
+	static constexpr char MAGIC[8] = {'V', 'K', 'E', 'P', 'A', 'C', 'K', '\0'};
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint64_t ALIGNMENT = 16;
+	static constexpr uint32_t CHUNK_SIZE = 64 * 1024;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t entryCount;
+		uint64_t indexOffset;
+		uint64_t namesOffset;
+		uint64_t namesSize;
+	};
+	struct Entry {
+		uint64_t hash; // `AssetPack::hash` of the name
+		uint64_t offset; // of the blob, from the start of the file
+		uint64_t size; // uncompressed
+		uint64_t storedSize; // in the file, including the chunk table
+		uint32_t chunkCount; // 0 if stored uncompressed
+		uint32_t nameOffset; // into the name table
+	};
+	static_assert(sizeof(Header) == 40 && sizeof(Entry) == 40, "pack structs have to be tightly packed");
+
+	struct Span {
+		const uint8_t *data;
+		size_t size;
+
+		explicit operator bool() const {
+			return data != nullptr;
+		}
+	};
+
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	int fd = -1; // kept open so entries can also be streamed with `AsyncIO` instead of faulted in through the mapping
+
+	const Header *header = nullptr;
+	const Entry *entries = nullptr;
+	const char *names = nullptr;
+public:
+	/// FNV-1a, names are paths relative to `res/` with forward slashes
+	static uint64_t hash(const char *name) {
+		uint64_t h = 0xcbf29ce484222325ull;
+		for(; *name; name++)
+			h = (h ^ (uint8_t) *name) * 0x100000001b3ull;
+		return h;
+	}
+
+	/// maps `path` and checks the header and index, false if it's missing or malformed
+	bool open(const char *path);
+	void close();
+
+	/// `nullptr` if there's no entry called `name`
+	const Entry *find(const char *name) const;
+	/// zero copy view of an uncompressed entry, empty if it's missing or compressed
+	Span view(const char *name) const;
+	/// copies or decompresses the entry into `out`, false if it's missing or corrupt
+	bool read(const char *name, std::vector<uint8_t> &out, ThreadPool *workers = nullptr) const;
+	/// decodes `entry` from its stored bytes, which don't have to come from the mapping. the calling thread
+	/// decodes chunks too, `workers` (if any) help out. fine to call from one of `workers` itself
+	static bool decompress(const Entry &entry, const uint8_t *stored, std::vector<uint8_t> &out, ThreadPool *workers = nullptr);
+
+	const char *name(const Entry &entry) const {
+		return names + entry.nameOffset;
+	}
+};
+
+#endif //ASSETPACK_HPP
@@ -0,0 +1,266 @@
+#include "AsyncIO.hpp"
+
+#include <util/AsyncLog.hpp>
+#include <util/Config.hpp>
+
+#include <algorithm>
+#include <cerrno>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// no liburing, the three syscalls and the ring layout are all we need
+static int ioUringSetup(uint32_t entries, io_uring_params *params) {
+	return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+static int ioUringEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags) {
+	return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+template<typename T>
+static T loadAcquire(const T *p) {
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+template<typename T>
+static void storeRelease(T *p, T value) {
+	__atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+void AsyncIO::create(uint32_t queueDepth, uint32_t threadCount) {
+	this->queueDepth = queueDepth;
+	inFlight = 0;
+	unsubmitted = 0;
+	ringFd = -1;
+	stopping = false;
+
+	backend = !config::is("VKENGINE_IO", "threads") && createRing() ? IO_URING : THREAD_POOL;
+
+	// never resized after this, the kernel holds pointers to the slots' `iovec`s
+	slots.resize(this->queueDepth);
+	freeSlots.clear();
+	for(uint32_t i = this->queueDepth; i > 0; i--)
+		freeSlots.push_back(i - 1);
+
+	if(backend == THREAD_POOL)
+		for(uint32_t i = 0; i < threadCount; i++)
+			threads.emplace_back(&AsyncIO::work, this);
+	asynclog::logln(litelogger::DEBUG, "Async I/O using %s, %u reads in flight at most", BACKEND_NAMES[backend], this->queueDepth);
+}
+bool AsyncIO::createRing() {
+	io_uring_params params = {};
+	ringFd = ioUringSetup(queueDepth, &params);
+	if(ringFd < 0) // old kernel, or blocked by seccomp in containers
+		return false;
+	queueDepth = std::min(queueDepth, params.sq_entries);
+
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+		sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+	sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+	cqRing = params.features & IORING_FEAT_SINGLE_MMAP ? sqRing :
+		mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+	sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+	if(sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED)
+		asynclog::exitError("Failed to map io_uring rings :(");
+
+	uint8_t *sq = static_cast<uint8_t*>(sqRing), *cq = static_cast<uint8_t*>(cqRing);
+	sqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+	sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+	sqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+	sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+	cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+	cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+	cqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+	return true;
+}
+void AsyncIO::destroy() {
+	wait();
+
+	if(backend == IO_URING) {
+		munmap(sqes, sqesSize);
+		if(cqRing != sqRing)
+			munmap(cqRing, cqRingSize);
+		munmap(sqRing, sqRingSize);
+		close(ringFd);
+	} else {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobsChanged.notify_all();
+		for(std::thread &t : threads)
+			t.join();
+		threads.clear();
+	}
+}
+
+void AsyncIO::submit(Read *reads, size_t count) {
+	for(size_t i = 0; i < count; i++) {
+		// the completion queue is only twice as deep as the submission queue, never have more in flight than fit
+		while(inFlight == queueDepth) {
+			flush();
+			waitOne();
+		}
+
+		Read &read = reads[i];
+		uint32_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		slots[slot].callback = std::move(read.callback);
+		slots[slot].vector = {read.buffer, read.size};
+		slots[slot].buffer = read.buffer;
+		slots[slot].fd = read.fd;
+		slots[slot].offset = read.offset;
+		slots[slot].size = read.size;
+		slots[slot].done = 0;
+		inFlight++;
+
+		if(backend == IO_URING) {
+			queueRead(slot);
+		} else {
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back({slot, read.fd, read.offset, read.buffer, read.size});
+		}
+	}
+
+	if(backend == IO_URING)
+		flush();
+	else
+		jobsChanged.notify_all();
+}
+void AsyncIO::queueRead(uint32_t slot) {
+	Slot &s = slots[slot];
+	s.vector = {static_cast<uint8_t*>(s.buffer) + s.done, s.size - s.done};
+
+	uint32_t tail = *sqTail;
+	uint32_t index = tail & *sqMask;
+	io_uring_sqe &sqe = sqes[index];
+	sqe = {};
+	sqe.opcode = IORING_OP_READV; // works back to 5.1, unlike IORING_OP_READ
+	sqe.fd = s.fd;
+	sqe.off = s.offset + s.done;
+	sqe.addr = reinterpret_cast<uint64_t>(&s.vector);
+	sqe.len = 1;
+	sqe.user_data = slot;
+	sqArray[index] = index;
+	storeRelease(sqTail, tail + 1);
+	unsubmitted++;
+}
+void AsyncIO::flush() {
+	// one syscall for the whole batch
+	while(backend == IO_URING && unsubmitted > 0) {
+		int submitted = ioUringEnter(ringFd, unsubmitted, 0, 0);
+		if(submitted < 0) {
+			if(errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				continue;
+			asynclog::exitError("io_uring_enter failed (%d) :(", errno);
+		}
+		unsubmitted -= submitted;
+	}
+}
+
+size_t AsyncIO::reap() {
+	std::vector<Completion> done;
+	if(backend == IO_URING) {
+		uint32_t head = *cqHead;
+		uint32_t tail = loadAcquire(cqTail);
+		bool resubmitted = false;
+		for(; head != tail; head++) {
+			const io_uring_cqe &cqe = cqes[head & *cqMask];
+			uint32_t slot = (uint32_t) cqe.user_data;
+			Slot &s = slots[slot];
+
+			// short reads and interruptions go back in for the rest, like the thread pool's `pread` loop
+			if(cqe.res == -EINTR || cqe.res == -EAGAIN || (cqe.res > 0 && s.done + cqe.res < s.size)) {
+				s.done += std::max(cqe.res, 0);
+				queueRead(slot);
+				resubmitted = true;
+				continue;
+			}
+			done.push_back({slot, cqe.res < 0 ? (int64_t) cqe.res : (int64_t) (s.done + cqe.res)});
+		}
+		storeRelease(cqHead, head);
+		if(resubmitted)
+			flush();
+	} else {
+		std::lock_guard<std::mutex> lock(mutex);
+		done.swap(completions);
+	}
+
+	// slots are given back before the callbacks run, so callbacks can submit follow up reads
+	std::vector<std::function<void(int64_t)>> callbacks;
+	callbacks.reserve(done.size());
+	for(const Completion &c : done) {
+		callbacks.push_back(std::move(slots[c.slot].callback));
+		freeSlots.push_back(c.slot);
+		inFlight--;
+	}
+	for(size_t i = 0; i < done.size(); i++)
+		if(callbacks[i])
+			callbacks[i](done[i].result);
+	return done.size();
+}
+size_t AsyncIO::poll() {
+	return reap();
+}
+size_t AsyncIO::waitOne() {
+	// a completion may just be a short read going back in, so keep waiting until something actually finished
+	size_t finished = 0;
+	while(finished == 0 && inFlight > 0) {
+		if(backend == IO_URING) {
+			flush();
+			while(*cqHead == loadAcquire(cqTail)) {
+				if(ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+					asynclog::exitError("io_uring_enter failed (%d) :(", errno);
+			}
+		} else {
+			std::unique_lock<std::mutex> lock(mutex);
+			completionsChanged.wait(lock, [&]() {
+				return !completions.empty();
+			});
+		}
+		finished = reap();
+	}
+	return finished;
+}
+void AsyncIO::wait() {
+	while(inFlight > 0)
+		waitOne();
+}
+
+void AsyncIO::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true) {
+		jobsChanged.wait(lock, [&]() {
+			return stopping || !jobs.empty();
+		});
+		if(jobs.empty())
+			return;
+
+		Job job = jobs.front();
+		jobs.pop_front();
+		lock.unlock();
+
+		int64_t result = 0;
+		while((size_t) result < job.size) {
+			ssize_t n = pread(job.fd, static_cast<uint8_t*>(job.buffer) + result, job.size - result, job.offset + result);
+			if(n < 0 && errno == EINTR)
+				continue;
+			if(n < 0) {
+				result = -errno;
+				break;
+			}
+			if(n == 0) // end of file
+				break;
+			result += n;
+		}
+
+		lock.lock();
+		completions.push_back({job.slot, result});
+		completionsChanged.notify_one();
+	}
+}
@@ -0,0 +1,106 @@
+#ifndef ASYNCIO_HPP
+#define ASYNCIO_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+
+/// Asynchronous file reads into caller provided memory, e.g. a persistently mapped staging buffer.
+/// Uses io_uring when the kernel allows it and falls back to a few threads calling `pread` otherwise.
+///
+/// Not thread safe: one thread submits, and callbacks run on that thread from `poll`/`wait`.
+class AsyncIO {
+public:
+	enum Backend : uint8_t {
+		IO_URING,
+		THREAD_POOL
+	};
+	static constexpr const char *BACKEND_NAMES[] = {"io_uring", "thread pool"};
+
+	struct Read {
+		int fd;
+		uint64_t offset;
+		void *buffer; // has to stay valid until the callback ran
+		size_t size;
+		std::function<void(int64_t result)> callback; // bytes read, or `-errno`
+	};
+
+	Backend backend;
+	uint32_t queueDepth; // reads in flight at once, further ones wait in `submit`
+	uint32_t inFlight;
+protected:
+	struct Slot {
+		std::function<void(int64_t)> callback;
+		iovec vector; // what's left to read
+		void *buffer;
+		int fd;
+		uint64_t offset; // of the whole read
+		size_t size;
+		size_t done; // short reads are resubmitted for the rest until this reaches `size`
+	};
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+
+	// io_uring
+	int ringFd;
+	void *sqRing, *cqRing;
+	size_t sqRingSize, cqRingSize;
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+	uint32_t *sqHead, *sqTail, *sqMask, *sqArray;
+	uint32_t *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe *cqes;
+	uint32_t unsubmitted; // queued in the SQ ring but not passed to the kernel yet
+
+	// thread pool fallback
+	struct Job {
+		uint32_t slot;
+		int fd;
+		uint64_t offset;
+		void *buffer;
+		size_t size;
+	};
+	struct Completion {
+		uint32_t slot;
+		int64_t result;
+	};
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable jobsChanged, completionsChanged;
+	std::deque<Job> jobs;
+	std::vector<Completion> completions;
+	bool stopping;
+public:
+	/// `VKENGINE_IO=threads` forces the thread pool
+	void create(uint32_t queueDepth = 256, uint32_t threadCount = 4);
+	/// waits for everything in flight first
+	void destroy();
+
+	/// queue `count` reads, handed to the kernel (or the pool) together
+	void submit(Read *reads, size_t count);
+	void submit(Read &&read) {
+		submit(&read, 1);
+	}
+
+	/// runs the callbacks of reads that finished, returns how many
+	size_t poll();
+	/// blocks until at least one read finished, then like `poll`
+	size_t waitOne();
+	/// blocks until every submitted read finished and its callback ran
+	void wait();
+protected:
+	bool createRing();
+	/// put the rest of `slot`'s read into the submission queue
+	void queueRead(uint32_t slot);
+	void flush();
+	size_t reap();
+	void work();
+};
+
+#endif //ASYNCIO_HPP
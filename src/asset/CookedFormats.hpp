@@ -0,0 +1,37 @@
+#ifndef COOKEDFORMATS_HPP
+#define COOKEDFORMATS_HPP
+
+#include <cstdint>
+
+/// Layouts written by `AssetCooker` and read back by the engine straight out of the `AssetPack`.
+/// Bump `VERSION` of a format whenever its layout changes, that also invalidates the cooker's cache.
+namespace cooked {
+	/// `.tex`, followed by `width * height` RGBA8 texels, rows top to bottom
+	struct TextureHeader {
+		static constexpr char MAGIC[4] = {'V', 'K', 'T', 'X'};
+		static constexpr uint32_t VERSION = 1;
+
+		char magic[4];
+		uint32_t version;
+		uint32_t width, height;
+	};
+	static_assert(sizeof(TextureHeader) == 16, "cooked structs have to be tightly packed");
+
+	struct MeshVertex {
+		float position[3];
+		float normal[3];
+		float uv[2];
+	};
+	/// `.mesh`, followed by `vertexCount` `MeshVertex`es and `indexCount` `uint32_t` indices of a triangle list
+	struct MeshHeader {
+		static constexpr char MAGIC[4] = {'V', 'K', 'M', 'S'};
+		static constexpr uint32_t VERSION = 1;
+
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexCount, indexCount;
+	};
+	static_assert(sizeof(MeshHeader) == 16 && sizeof(MeshVertex) == 32, "cooked structs have to be tightly packed");
+}
+
+#endif //COOKEDFORMATS_HPP
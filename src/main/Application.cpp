@@ -2,25 +2,72 @@
 
 #include <glm/ext/matrix_transform.hpp>
 
+#include <algorithm>
+
 const litelogger::Logger Application::VALIDATION("Validation", "[\033[1;35m%s\033[0m %s]: ", -1, stdout);
 const litelogger::Logger Application::APPLICATION("Application", "[\033[1;36m%s\033[0m %s]: ", 0, stdout);
 
 void Application::init() {
 	frame = 0;
+	simulationFrame = 0;
+	animationFrame = 0;
+	sceneVersion = 0;
+	resourceVersion = 0;
+	visibilityVersion = 0;
+	renderedVisibilityVersion = 0;
+	reuseCommandBuffers = true;
 	frameOverlap = 2;
 
-	initInstance();
-	initWindow();
-	initPhysicalDevice();
-	initLogicalDevice();
-	initMemoryAllocator();
-	initSwapchain();
-	initRenderPass();
-	initFramebuffers();
-	initFrames();
-	initVertexArray();
-	initDescriptors();
-	initGraphicsPipeline();
+	redrawMode = config::is("VKENGINE_REDRAW", "ondemand") ? ON_DEMAND : CONTINUOUS;
+	animateCamera = redrawMode == CONTINUOUS;
+	renderPath = config::is("VKENGINE_RENDER_PATH", "dynamic") ? DYNAMIC_RENDERING : RENDER_PASS;
+	viewCount = std::clamp<long>(config::getInt("VKENGINE_VIEWS", 1), 1, CameraData::MAX_VIEWS);
+	shading = config::is("VKENGINE_SHADING", "deferred") ? DEFERRED : FORWARD;
+	if(shading == DEFERRED && renderPath == DYNAMIC_RENDERING) {
+		asynclog::logln(litelogger::WARN, "Deferred shading reads the G-buffer through subpass inputs, using render passes");
+		renderPath = RENDER_PASS;
+	}
+	fragShaderName = shading == DEFERRED ? "gbuffer.frag" : "triangle.frag";
+	lightCount = std::clamp<long>(config::getInt("VKENGINE_LIGHTS", 64), 0, clusters::MAX_LIGHTS);
+	validateClusters = config::is("VKENGINE_VALIDATE_CLUSTERS", "1");
+	shadowDistance = 20.0f;
+	shadowSceneVersion = UINT64_MAX;
+	occlusionMode = config::is("VKENGINE_OCCLUSION", "hiz") ? HIZ_OCCLUSION : config::is("VKENGINE_OCCLUSION", "cpu") ? CPU_OCCLUSION : NO_OCCLUSION;
+	if(occlusionMode == HIZ_OCCLUSION && shading == DEFERRED) {
+		asynclog::logln(litelogger::WARN, "The G-buffer depth never leaves the render pass, no Hi-Z occlusion culling with deferred shading");
+		occlusionMode = NO_OCCLUSION;
+	}
+
+	// independent stages run concurrently, `VKENGINE_STARTUP_THREADS=0` runs them one after another
+	uint32_t startupThreads = std::clamp<long>(config::getInt("VKENGINE_STARTUP_THREADS", std::min(std::thread::hardware_concurrency(), 3u)), 0, std::thread::hardware_concurrency());
+
+	TaskGraph startup;
+	TaskGraph::TaskHandle instanceTask = startup.add("instance", [this]() { initInstance(); });
+	TaskGraph::TaskHandle windowTask = startup.add("window", [this]() { initWindow(); }, {}, true);
+	TaskGraph::TaskHandle assetsTask = startup.add("assets", [this]() { initAssets(); });
+	TaskGraph::TaskHandle surfaceTask = startup.add("surface", [this]() { initSurface(); }, {instanceTask, windowTask});
+	TaskGraph::TaskHandle physicalDeviceTask = startup.add("physical device", [this]() { initPhysicalDevice(); }, {instanceTask});
+	TaskGraph::TaskHandle logicalDeviceTask = startup.add("logical device", [this]() { initLogicalDevice(); }, {physicalDeviceTask, surfaceTask});
+	TaskGraph::TaskHandle allocatorTask = startup.add("memory allocator", [this]() { initMemoryAllocator(); }, {logicalDeviceTask});
+	// queries the framebuffer size from GLFW
+	TaskGraph::TaskHandle swapchainTask = startup.add("swapchain", [this]() { initSwapchain(); }, {logicalDeviceTask}, true);
+	TaskGraph::TaskHandle renderPassTask = startup.add("render pass", [this]() { initRenderPass(); }, {swapchainTask});
+	TaskGraph::TaskHandle framebuffersTask = startup.add("framebuffers", [this]() { initFramebuffers(); }, {renderPassTask, allocatorTask});
+	TaskGraph::TaskHandle framesTask = startup.add("frames", [this]() { initFrames(); }, {swapchainTask});
+	TaskGraph::TaskHandle assetLoaderTask = startup.add("asset loader", [this]() { initAssetLoader(); }, {allocatorTask, assetsTask});
+	TaskGraph::TaskHandle vertexArrayTask = startup.add("vertex array", [this]() { initVertexArray(); }, {assetLoaderTask});
+	TaskGraph::TaskHandle descriptorsTask = startup.add("descriptors", [this]() { initDescriptors(); }, {framesTask, allocatorTask, assetsTask});
+	TaskGraph::TaskHandle graphicsPipelineTask = startup.add("graphics pipeline", [this]() { initGraphicsPipeline(); }, {descriptorsTask, renderPassTask, vertexArrayTask, assetsTask});
+	startup.add("lighting pass", [this]() { initLightingPass(); }, {graphicsPipelineTask, framebuffersTask});
+	TaskGraph::TaskHandle lightCullingTask = startup.add("light culling", [this]() { initLightCulling(); }, {graphicsPipelineTask});
+	startup.add("shadows", [this]() { initShadows(); }, {lightCullingTask}); // writes the same descriptor sets
+	startup.add("occlusion culling", [this]() { initOcclusionCulling(); }, {graphicsPipelineTask, framebuffersTask});
+
+	startup.run(startupThreads);
+	startup.logTimings(APPLICATION, "Startup");
+
+	redraw.setContinuous(RedrawTracker::ANIMATION, animateCamera);
+	redraw.request(RedrawTracker::SCENE); // first frame
 }
 void Application::initInstance() {
 	vk::ApplicationInfo applicationInfo(
@@ -30,41 +77,74 @@ void Application::initInstance() {
 	);
 
 	instanceExtensions = {};
-	validationLayers = {"VK_LAYER_KHRONOS_validation"};
+	validationLayers = {};
 	{
 		uint32_t glfwExtensionCount;
 		const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 		instanceExtensions.insert(instanceExtensions.end(), &glfwExtensions[0], &glfwExtensions[glfwExtensionCount]);
 	}
-	instance = vk::createInstance(vk::InstanceCreateInfo(vk::InstanceCreateFlags(),
+	VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
+
+	validation.configure(Validation::tierFromConfig(), VALIDATION, validationLayers, instanceExtensions);
+
+	vk::InstanceCreateInfo instanceCreateInfo(vk::InstanceCreateFlags(),
 		&applicationInfo,
 		validationLayers.size(), validationLayers.data(),
 		instanceExtensions.size(), instanceExtensions.data()
-	));
+	);
+	instanceCreateInfo.pNext = validation.instancePNext();
+	instance = vk::createInstance(instanceCreateInfo);
+	VULKAN_HPP_DEFAULT_DISPATCHER.init(instance);
+
+	validation.createMessenger(instance);
 
-	deletionQueue.push([=]() {
+	deletionQueue.push([=, this]() {
 		instance.destroy();
 	});
+	deletionQueue.push([=, this]() {
+		validation.destroy(instance);
+	});
 
-	litelogger::logln(APPLICATION, "Created instance successfully :)");
+	asynclog::logln(APPLICATION, "Created instance successfully :)");
 }
 void Application::initWindow() {
 	window = Window(854, 480, "Hello Triangle", false);
 	window.create();
+
+	glfwSetWindowUserPointer(window, this);
+	glfwSetKeyCallback(window, [](GLFWwindow *w, int, int, int, int) {
+		static_cast<Application*>(glfwGetWindowUserPointer(w))->redraw.request(RedrawTracker::INPUT);
+	});
+	glfwSetMouseButtonCallback(window, [](GLFWwindow *w, int, int, int) {
+		static_cast<Application*>(glfwGetWindowUserPointer(w))->redraw.request(RedrawTracker::INPUT);
+	});
+	glfwSetCursorPosCallback(window, [](GLFWwindow *w, double, double) {
+		static_cast<Application*>(glfwGetWindowUserPointer(w))->redraw.request(RedrawTracker::INPUT);
+	});
+	glfwSetScrollCallback(window, [](GLFWwindow *w, double, double) {
+		static_cast<Application*>(glfwGetWindowUserPointer(w))->redraw.request(RedrawTracker::INPUT);
+	});
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow *w) {
+		static_cast<Application*>(glfwGetWindowUserPointer(w))->redraw.request(RedrawTracker::WINDOW);
+	});
+	glfwSetFramebufferSizeCallback(window, [](GLFWwindow *w, int, int) {
+		static_cast<Application*>(glfwGetWindowUserPointer(w))->redraw.request(RedrawTracker::WINDOW);
+	});
+
+	asynclog::logln(APPLICATION, "Window created successfully :)");
+}
+void Application::initSurface() {
 	window.createSurface(instance);
 
-	deletionQueue.push([=]() {
+	deletionQueue.push([=, this]() {
 		window.destroy(instance);
 	});
-
-	litelogger::logln(APPLICATION, "Window created successfully :)");
 }
 void Application::initPhysicalDevice() {
 	deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
 	std::vector<vk::PhysicalDevice> devices = instance.enumeratePhysicalDevices();
 
-	vk::PhysicalDevice *bestDevice;
 	int16_t bestRating = INT16_MIN;
 	for(vk::PhysicalDevice d : devices) {
 		int16_t rating = 0;
@@ -100,12 +180,61 @@ void Application::initPhysicalDevice() {
 				break;
 		}
 		if(rating > bestRating) {
-			bestDevice = &d;
+			physicalDevice = d;
+			physicalDeviceProperties = properties;
+			physicalDeviceMemoryProperties = memoryProperties;
 			bestRating = rating;
 		}
 	}
 
-	physicalDevice = *bestDevice;
+	memoryBudgetSupported = false;
+	std::vector<vk::ExtensionProperties> extensions = physicalDevice.enumerateDeviceExtensionProperties();
+	auto supported = [&](const char *name) {
+		return std::any_of(extensions.begin(), extensions.end(), [&](const vk::ExtensionProperties &e) {
+			return strcmp(e.extensionName, name) == 0;
+		});
+	};
+	if(supported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+		deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		memoryBudgetSupported = true;
+	}
+
+	if(renderPath == DYNAMIC_RENDERING) {
+		// the engine targets 1.1, so these are still extensions. dynamic rendering needs the other two there
+		std::array<const char *, 4> required = {
+			VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+			VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+			VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+			VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME
+		};
+		bool available = std::all_of(required.begin(), required.end(), supported);
+		if(available) {
+			auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDynamicRenderingFeaturesKHR, vk::PhysicalDeviceSynchronization2FeaturesKHR>();
+			available = features.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering && features.get<vk::PhysicalDeviceSynchronization2FeaturesKHR>().synchronization2;
+		}
+
+		if(available) {
+			deviceExtensions.insert(deviceExtensions.end(), required.begin(), required.end());
+		} else {
+			asynclog::logln(litelogger::WARN, "%s doesn't support dynamic rendering, using render passes", physicalDeviceProperties.deviceName.data());
+			renderPath = RENDER_PASS;
+		}
+	}
+
+	// the shaders always index their matrices with `gl_ViewIndex` (0 without multiview), so the feature is
+	// needed even for a single view. it's core in 1.1 and every 1.1 device has to support it
+	auto multiviewFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMultiviewFeatures>();
+	if(!multiviewFeatures.get<vk::PhysicalDeviceMultiviewFeatures>().multiview)
+		asynclog::exitError("%s doesn't support multiview :(", physicalDeviceProperties.deviceName.data());
+
+	auto multiviewProperties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceMultiviewProperties>();
+	uint32_t maxViews = multiviewProperties.get<vk::PhysicalDeviceMultiviewProperties>().maxMultiviewViewCount;
+	if(viewCount > maxViews) {
+		asynclog::logln(litelogger::WARN, "%s renders at most %u views in one pass, not %u", physicalDeviceProperties.deviceName.data(), maxViews, viewCount);
+		viewCount = maxViews;
+	}
+
+	depthFormat = GBuffer::depthFormat(physicalDevice);
 }
 void Application::initLogicalDevice() {
 	std::vector<vk::QueueFamilyProperties> queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
@@ -117,41 +246,107 @@ void Application::initLogicalDevice() {
 			goto found;
 		}
 	}
-	litelogger::exitError("Couldn't find supported queue family :(");
+	asynclog::exitError("Couldn't find supported queue family :(");
 	found:
 
+	// a second queue from the same family lets transfers run alongside rendering without queue family ownership transfers
+	transferQueueFamily = graphicsQueueFamily;
+	uint32_t queueCount = std::min<uint32_t>(queueFamilyProperties[graphicsQueueFamily].queueCount, 2);
+
 	std::vector<float> queuePriorities = {
-		1.0f
+		1.0f,
+		0.5f
 	};
 	std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos = {
-		vk::DeviceQueueCreateInfo(vk::DeviceQueueCreateFlags(), graphicsQueueFamily, 1, queuePriorities.data())
+		vk::DeviceQueueCreateInfo(vk::DeviceQueueCreateFlags(), graphicsQueueFamily, queueCount, queuePriorities.data())
 	};
 
 	vk::PhysicalDeviceFeatures physicalDeviceFeatures;
-	device = physicalDevice.createDevice(vk::DeviceCreateInfo(vk::DeviceCreateFlags(),
+	vk::DeviceCreateInfo deviceCreateInfo(vk::DeviceCreateFlags(),
 		queueCreateInfos.size(), queueCreateInfos.data(),
-		validationLayers.size(), validationLayers.data(), // deprecated
+		0, nullptr, // device layers are deprecated, the instance layers apply
 		deviceExtensions.size(), deviceExtensions.data(),
 		&physicalDeviceFeatures
-	));
+	);
+
+	vk::PhysicalDeviceSynchronization2FeaturesKHR synchronization2Features(VK_TRUE);
+	vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures(VK_TRUE, &synchronization2Features);
+	vk::PhysicalDeviceMultiviewFeatures multiviewFeatures(VK_TRUE);
+	deviceCreateInfo.pNext = &multiviewFeatures;
+	if(renderPath == DYNAMIC_RENDERING)
+		multiviewFeatures.pNext = &dynamicRenderingFeatures;
+
+	device = physicalDevice.createDevice(deviceCreateInfo);
+
+	// from now on device functions are called directly instead of through the loader's dispatch
+	VULKAN_HPP_DEFAULT_DISPATCHER.init(device);
 
 	device.getQueue(graphicsQueueFamily, 0, &graphicsQueue);
+	device.getQueue(transferQueueFamily, queueCount - 1, &transferQueue);
 
-	deletionQueue.push([=](){
+	deletionQueue.push([=, this](){
 		device.destroy();
 	});
 
-	litelogger::logln(APPLICATION, "Created logical device successfully :)");
+	layoutCache.create(device);
+	deletionQueue.push([=, this](){
+		layoutCache.destroy();
+	});
+
+	asynclog::logln(APPLICATION, "Created logical device successfully :)");
 }
 void Application::initMemoryAllocator() {
-	allocator = vma::createAllocator(vma::AllocatorCreateInfo(vma::AllocatorCreateFlags(),
-		physicalDevice, device, 0, nullptr, nullptr, 0, nullptr, nullptr, nullptr, instance, VK_API_VERSION_1_1
+	vma::AllocatorCreateFlags allocatorFlags;
+	if(memoryBudgetSupported)
+		allocatorFlags |= vma::AllocatorCreateFlagBits::eExtMemoryBudget;
+
+	// let VMA use the same device level function pointers as the rest of the engine
+	const auto &d = VULKAN_HPP_DEFAULT_DISPATCHER;
+	vma::VulkanFunctions vulkanFunctions = vma::VulkanFunctions()
+		.setVkGetInstanceProcAddr(d.vkGetInstanceProcAddr)
+		.setVkGetDeviceProcAddr(d.vkGetDeviceProcAddr)
+		.setVkGetPhysicalDeviceProperties(d.vkGetPhysicalDeviceProperties)
+		.setVkGetPhysicalDeviceMemoryProperties(d.vkGetPhysicalDeviceMemoryProperties)
+		.setVkAllocateMemory(d.vkAllocateMemory)
+		.setVkFreeMemory(d.vkFreeMemory)
+		.setVkMapMemory(d.vkMapMemory)
+		.setVkUnmapMemory(d.vkUnmapMemory)
+		.setVkFlushMappedMemoryRanges(d.vkFlushMappedMemoryRanges)
+		.setVkInvalidateMappedMemoryRanges(d.vkInvalidateMappedMemoryRanges)
+		.setVkBindBufferMemory(d.vkBindBufferMemory)
+		.setVkBindImageMemory(d.vkBindImageMemory)
+		.setVkGetBufferMemoryRequirements(d.vkGetBufferMemoryRequirements)
+		.setVkGetImageMemoryRequirements(d.vkGetImageMemoryRequirements)
+		.setVkCreateBuffer(d.vkCreateBuffer)
+		.setVkDestroyBuffer(d.vkDestroyBuffer)
+		.setVkCreateImage(d.vkCreateImage)
+		.setVkDestroyImage(d.vkDestroyImage)
+		.setVkCmdCopyBuffer(d.vkCmdCopyBuffer)
+		// core in 1.1, the dispatcher fills the core names from the KHR ones if needed
+		.setVkGetBufferMemoryRequirements2KHR(d.vkGetBufferMemoryRequirements2)
+		.setVkGetImageMemoryRequirements2KHR(d.vkGetImageMemoryRequirements2)
+		.setVkBindBufferMemory2KHR(d.vkBindBufferMemory2)
+		.setVkBindImageMemory2KHR(d.vkBindImageMemory2)
+		.setVkGetPhysicalDeviceMemoryProperties2KHR(d.vkGetPhysicalDeviceMemoryProperties2);
+
+	allocator = vma::createAllocator(vma::AllocatorCreateInfo(allocatorFlags,
+		physicalDevice, device, 0, nullptr, nullptr, 0, nullptr, &vulkanFunctions, nullptr, instance, VK_API_VERSION_1_1
 	));
-	deletionQueue.push([=](){
+	memoryBudget.create(allocator, memoryBudgetSupported);
+	defragmenter.create(device, transferQueue, transferQueueFamily, &transferQueueMutex);
+
+	deletionQueue.push([=, this](){
 		allocator.destroy();
 	});
+	deletionQueue.push([=, this](){
+		memoryBudget.logStats(APPLICATION);
+		memoryBudget.destroy();
+	});
+	deletionQueue.push([=, this](){
+		defragmenter.destroy();
+	});
 
-	litelogger::logln(APPLICATION, "Initialized VMA successfully :)");
+	asynclog::logln(APPLICATION, "Initialized VMA successfully :)");
 }
 void Application::initSwapchain() {
 	// TODO make resizable
@@ -187,6 +382,17 @@ void Application::initSwapchain() {
 		surfaceFormat = formats[0];
 	}
 
+	// several views are rendered into `multiview` first and copied over
+	vk::ImageUsageFlags imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+	if(viewCount > 1) {
+		if(surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst) {
+			imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+		} else {
+			asynclog::logln(litelogger::WARN, "Swapchain images can't be copied to, rendering a single view");
+			viewCount = 1;
+		}
+	}
+
 	device.waitIdle();
 //	vk::SwapchainKHR oldSwapchain = window.swapchain;
 
@@ -203,7 +409,7 @@ void Application::initSwapchain() {
 			surfaceFormat.colorSpace,
 			extent,
 			1,
-			vk::ImageUsageFlagBits::eColorAttachment,
+			imageUsage,
 			vk::SharingMode::eExclusive,
 			0,
 			nullptr,
@@ -216,15 +422,150 @@ void Application::initSwapchain() {
 	);
 	swapchainImageFormat = surfaceFormat.format;
 	swapchainExtent = extent;
+	renderExtent = viewCount > 1 ? MultiviewTarget::viewExtent(extent, viewCount) : extent;
 	swapchainImages = device.getSwapchainImagesKHR(swapchain);
 
-	deletionQueue.push([=]() {
+	deletionQueue.push([=, this]() {
 		device.destroySwapchainKHR(swapchain);
 	});
 
-	litelogger::logln(APPLICATION, "Swapchain (re)created successfully :)");
+	asynclog::logln(APPLICATION, "Swapchain (re)created successfully :)");
 }
 void Application::initRenderPass() {
+	if(renderPath == DYNAMIC_RENDERING) {
+		asynclog::logln(APPLICATION, "Using dynamic rendering, no renderpass needed :)");
+		return;
+	}
+	if(shading == DEFERRED) {
+		initDeferredRenderPass();
+		return;
+	}
+
+	// with occlusion culling the pass is split in two around the pyramid build, `renderPass` clears and keeps
+	// the depth for it, `disoccludedRenderPass` picks up where it left off. both fit the same framebuffers
+	bool split = occlusionMode == HIZ_OCCLUSION;
+	vk::ImageLayout presentLayout = viewCount > 1 ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+	auto create = [&](bool first, bool last) {
+		std::vector<vk::AttachmentDescription> attachmentDescriptions = {
+			vk::AttachmentDescription(
+				vk::AttachmentDescriptionFlags(),
+				swapchainImageFormat,
+				vk::SampleCountFlagBits::e1,
+				first ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad,
+				vk::AttachmentStoreOp::eStore,
+				vk::AttachmentLoadOp::eDontCare,
+				vk::AttachmentStoreOp::eDontCare,
+				first ? vk::ImageLayout::eUndefined : vk::ImageLayout::eColorAttachmentOptimal,
+				last ? presentLayout : vk::ImageLayout::eColorAttachmentOptimal
+			),
+			vk::AttachmentDescription(
+				vk::AttachmentDescriptionFlags(),
+				depthFormat,
+				vk::SampleCountFlagBits::e1,
+				first ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad,
+				last ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore,
+				vk::AttachmentLoadOp::eDontCare,
+				vk::AttachmentStoreOp::eDontCare,
+				first ? vk::ImageLayout::eUndefined : vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+				last ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eDepthStencilReadOnlyOptimal
+			)
+		};
+
+		std::vector<vk::AttachmentReference> colorReferences = {
+			vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal)
+		};
+		vk::AttachmentReference depthReference(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+		std::vector<vk::SubpassDescription> subpasses = {
+			vk::SubpassDescription(
+				vk::SubpassDescriptionFlags(),
+				vk::PipelineBindPoint::eGraphics,
+				0,
+				nullptr,
+				colorReferences.size(),
+				colorReferences.data(),
+				nullptr,
+				&depthReference,
+				0,
+				nullptr
+			)
+		};
+
+		// with several views the previous frame's copy out of the shared multiview image has to finish first.
+		// the depth buffer is shared too, the previous frame's tests and pyramid build have to be done with it
+		vk::PipelineStageFlags externalStages = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests;
+		if(viewCount > 1)
+			externalStages |= vk::PipelineStageFlagBits::eTransfer;
+		if(split)
+			externalStages |= vk::PipelineStageFlagBits::eComputeShader;
+		// clearing over the previous frame's writes is a write after write, those have to be made available first
+		vk::AccessFlags externalAccess = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+		if(viewCount > 1)
+			externalAccess |= vk::AccessFlagBits::eColorAttachmentWrite;
+		std::vector<vk::SubpassDependency> dependencies = {
+			vk::SubpassDependency(
+				VK_SUBPASS_EXTERNAL,
+				0,
+				externalStages,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+				externalAccess,
+				vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				vk::DependencyFlags()
+			)
+		};
+		// the pyramid is built from the depth, and the second pass keeps drawing into the color attachment
+		if(!last)
+			dependencies.push_back(vk::SubpassDependency(
+				0,
+				VK_SUBPASS_EXTERNAL,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eComputeShader,
+				vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eShaderRead,
+				vk::DependencyFlags()
+			));
+		if(last && viewCount > 1)
+			dependencies.push_back(vk::SubpassDependency(
+				0,
+				VK_SUBPASS_EXTERNAL,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlagBits::eColorAttachmentWrite,
+				vk::AccessFlagBits::eTransferRead,
+				vk::DependencyFlags()
+			));
+
+		vk::RenderPassCreateInfo renderPassCreateInfo(
+			vk::RenderPassCreateFlags(),
+			attachmentDescriptions.size(),
+			attachmentDescriptions.data(),
+			subpasses.size(),
+			subpasses.data(),
+			dependencies.size(),
+			dependencies.data()
+		);
+
+		// every view goes to its own layer of the attachment, the views are close so they're marked as correlated
+		uint32_t viewMask = (1u << viewCount) - 1;
+		vk::RenderPassMultiviewCreateInfo multiviewCreateInfo(1, &viewMask, 0, nullptr, 1, &viewMask);
+		if(viewCount > 1)
+			renderPassCreateInfo.pNext = &multiviewCreateInfo;
+
+		return device.createRenderPass(renderPassCreateInfo);
+	};
+
+	renderPass = create(true, !split);
+	disoccludedRenderPass = split ? create(false, true) : nullptr;
+	deletionQueue.push([=, this]() {
+		if(disoccludedRenderPass)
+			device.destroyRenderPass(disoccludedRenderPass);
+		device.destroyRenderPass(renderPass);
+	});
+
+	asynclog::logln(APPLICATION, "Renderpass created successfully :)");
+}
+void Application::initDeferredRenderPass() {
+	// attachment 0 is what ends up on screen, the G-buffer only lives for the duration of the pass
 	std::vector<vk::AttachmentDescription> attachmentDescriptions = {
 		vk::AttachmentDescription(
 			vk::AttachmentDescriptionFlags(),
@@ -235,22 +576,59 @@ void Application::initRenderPass() {
 			vk::AttachmentLoadOp::eDontCare,
 			vk::AttachmentStoreOp::eDontCare,
 			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::ePresentSrcKHR
+			viewCount > 1 ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR
 		)
 	};
+	for(uint8_t a = 0; a < GBuffer::ATTACHMENT_COUNT; a++) {
+		bool depth = a == GBuffer::DEPTH;
+		attachmentDescriptions.push_back(vk::AttachmentDescription(
+			vk::AttachmentDescriptionFlags(),
+			depth ? GBuffer::depthFormat(physicalDevice) : GBuffer::COLOR_FORMATS[a],
+			vk::SampleCountFlagBits::e1,
+			vk::AttachmentLoadOp::eClear,
+			vk::AttachmentStoreOp::eDontCare, // never written back, this is what keeps it on chip
+			vk::AttachmentLoadOp::eDontCare,
+			vk::AttachmentStoreOp::eDontCare,
+			vk::ImageLayout::eUndefined,
+			depth ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal
+		));
+	}
 
-	std::vector<vk::AttachmentReference> colorReferences = {
-		vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal)
+	std::array<vk::AttachmentReference, 2> gbufferReferences = {
+		vk::AttachmentReference(1 + GBuffer::ALBEDO, vk::ImageLayout::eColorAttachmentOptimal),
+		vk::AttachmentReference(1 + GBuffer::NORMAL, vk::ImageLayout::eColorAttachmentOptimal)
+	};
+	vk::AttachmentReference depthReference(1 + GBuffer::DEPTH, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+	// input attachment `i` is `input_attachment_index = i` in deferred_light.frag
+	std::array<vk::AttachmentReference, GBuffer::ATTACHMENT_COUNT> inputReferences = {
+		vk::AttachmentReference(1 + GBuffer::ALBEDO, vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::AttachmentReference(1 + GBuffer::NORMAL, vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::AttachmentReference(1 + GBuffer::DEPTH, vk::ImageLayout::eDepthStencilReadOnlyOptimal)
 	};
+	vk::AttachmentReference colorReference(0, vk::ImageLayout::eColorAttachmentOptimal);
 
 	std::vector<vk::SubpassDescription> subpasses = {
+		// geometry
 		vk::SubpassDescription(
 			vk::SubpassDescriptionFlags(),
 			vk::PipelineBindPoint::eGraphics,
 			0,
 			nullptr,
-			colorReferences.size(),
-			colorReferences.data(),
+			gbufferReferences.size(),
+			gbufferReferences.data(),
+			nullptr,
+			&depthReference,
+			0,
+			nullptr
+		),
+		// lighting
+		vk::SubpassDescription(
+			vk::SubpassDescriptionFlags(),
+			vk::PipelineBindPoint::eGraphics,
+			inputReferences.size(),
+			inputReferences.data(),
+			1,
+			&colorReference,
 			nullptr,
 			nullptr,
 			0,
@@ -258,38 +636,117 @@ void Application::initRenderPass() {
 		)
 	};
 
+	// the G-buffer is shared between frames in flight, the previous frame's geometry writes have to be
+	// available and its lighting reads done before it's cleared again. attachment 0 is first used by the
+	// lighting subpass, its transition waits for the acquire semaphore (and the previous copy out of the
+	// multiview image) with a dependency of its own
+	vk::PipelineStageFlags outputStages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	if(viewCount > 1)
+		outputStages |= vk::PipelineStageFlagBits::eTransfer;
+	vk::DependencyFlags viewLocal = viewCount > 1 ? vk::DependencyFlagBits::eViewLocal : vk::DependencyFlags();
 	std::vector<vk::SubpassDependency> dependencies = {
 		vk::SubpassDependency(
 			VK_SUBPASS_EXTERNAL,
 			0,
-			vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eFragmentShader,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+			vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+			vk::DependencyFlags()
+		),
+		vk::SubpassDependency(
+			VK_SUBPASS_EXTERNAL,
+			1,
+			outputStages,
 			vk::PipelineStageFlagBits::eColorAttachmentOutput,
 			vk::AccessFlagBits::eNone,
 			vk::AccessFlagBits::eColorAttachmentWrite,
 			vk::DependencyFlags()
+		),
+		// by region: every pixel only reads what the geometry subpass wrote at the same pixel, so tilers
+		// run both subpasses tile by tile without a round trip through memory
+		vk::SubpassDependency(
+			0,
+			1,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::PipelineStageFlagBits::eFragmentShader,
+			vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+			vk::AccessFlagBits::eInputAttachmentRead,
+			vk::DependencyFlagBits::eByRegion | viewLocal
 		)
 	};
+	if(viewCount > 1)
+		dependencies.push_back(vk::SubpassDependency(
+			1,
+			VK_SUBPASS_EXTERNAL,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::AccessFlagBits::eColorAttachmentWrite,
+			vk::AccessFlagBits::eTransferRead,
+			vk::DependencyFlags()
+		));
 
-	renderPass = device.createRenderPass(
-		vk::RenderPassCreateInfo(
-			vk::RenderPassCreateFlags(),
-			attachmentDescriptions.size(),
-			attachmentDescriptions.data(),
-			subpasses.size(),
-			subpasses.data(),
-			dependencies.size(),
-			dependencies.data()
-		)
+	vk::RenderPassCreateInfo renderPassCreateInfo(
+		vk::RenderPassCreateFlags(),
+		attachmentDescriptions.size(),
+		attachmentDescriptions.data(),
+		subpasses.size(),
+		subpasses.data(),
+		dependencies.size(),
+		dependencies.data()
 	);
-	deletionQueue.push([=]() {
+
+	std::array<uint32_t, 2> viewMasks = {(1u << viewCount) - 1, (1u << viewCount) - 1};
+	vk::RenderPassMultiviewCreateInfo multiviewCreateInfo(viewMasks.size(), viewMasks.data(), 0, nullptr, 1, &viewMasks[0]);
+	if(viewCount > 1)
+		renderPassCreateInfo.pNext = &multiviewCreateInfo;
+
+	renderPass = device.createRenderPass(renderPassCreateInfo);
+	deletionQueue.push([=, this]() {
 		device.destroyRenderPass(renderPass);
 	});
 
-	litelogger::logln(APPLICATION, "Renderpass created successfully :)");
+	asynclog::logln(APPLICATION, "Deferred renderpass created successfully :)");
 }
 void Application::initFramebuffers() {
+	if(viewCount > 1) {
+		multiview.create(device, allocator, memoryBudget.allocationCreateInfo(MemoryBudget::RENDER_TARGETS), swapchainImageFormat, swapchainExtent, viewCount);
+		deletionQueue.push([=, this]() {
+			multiview.destroy();
+		});
+	}
+	if(shading == DEFERRED) {
+		gbuffer.create(device, physicalDevice, allocator, renderExtent, viewCount);
+		deletionQueue.push([=, this]() {
+			gbuffer.destroy();
+		});
+		asynclog::logln(APPLICATION, "G-buffer created in %s memory :)", gbuffer.lazilyAllocated ? "lazily allocated" : "device local");
+	} else {
+		// not from the render target pool, depth images can need other memory types than the color ones it was picked for
+		vk::ImageUsageFlags depthUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+		if(occlusionMode == HIZ_OCCLUSION)
+			depthUsage |= vk::ImageUsageFlagBits::eSampled; // level 0 of the pyramid is reduced from it
+		depthImage = allocator.createImage(
+			vk::ImageCreateInfo(vk::ImageCreateFlags(),
+				vk::ImageType::e2D, depthFormat, vk::Extent3D(renderExtent, 1), 1, viewCount,
+				vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, depthUsage
+			),
+			vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eGpuOnly)
+		);
+		allocator.setAllocationName(depthImage.second, "Depth buffer");
+		depthImageView = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(),
+			depthImage.first, viewCount > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D, depthFormat, vk::ComponentMapping(),
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, viewCount)
+		));
+		deletionQueue.push([=, this]() {
+			device.destroyImageView(depthImageView);
+			allocator.destroyImage(depthImage.first, depthImage.second);
+		});
+	}
+
 	swapchainImageViews.resize(swapchainImages.size());
-	swapchainFramebuffers.resize(swapchainImages.size());
+	if(renderPath == RENDER_PASS)
+		swapchainFramebuffers.resize(swapchainImages.size());
 
 	for(uint8_t i = 0; i < swapchainImages.size(); i++) {
 		swapchainImageViews[i] = device.createImageView(vk::ImageViewCreateInfo(
@@ -307,7 +764,20 @@ void Application::initFramebuffers() {
 			)
 		));
 
-		std::array<vk::ImageView, 1> attachments = {swapchainImageViews[i]};
+		deletionQueue.push([=, this]() {
+			device.destroyImageView(swapchainImageViews[i]);
+		});
+
+		// dynamic rendering takes the image views directly when recording
+		if(renderPath == DYNAMIC_RENDERING)
+			continue;
+
+		// multiview framebuffers have a single layer, the view mask picks the attachment's layers
+		std::vector<vk::ImageView> attachments = {viewCount > 1 ? multiview.view : swapchainImageViews[i]};
+		if(shading == DEFERRED)
+			attachments.insert(attachments.end(), std::begin(gbuffer.views), std::end(gbuffer.views));
+		else
+			attachments.push_back(depthImageView);
 
 		swapchainFramebuffers[i] = device.createFramebuffer(
 			vk::FramebufferCreateInfo(
@@ -315,19 +785,18 @@ void Application::initFramebuffers() {
 				renderPass,
 				attachments.size(),
 				attachments.data(),
-				swapchainExtent.width,
-				swapchainExtent.height,
+				renderExtent.width,
+				renderExtent.height,
 				1
 			)
 		);
 
-		deletionQueue.push([=]() {
+		deletionQueue.push([=, this]() {
 			device.destroyFramebuffer(swapchainFramebuffers[i]);
-			device.destroyImageView(swapchainImageViews[i]);
 		});
 	}
 
-	litelogger::logln(APPLICATION, "Framebuffers created successfully :)");
+	asynclog::logln(APPLICATION, "Framebuffers created successfully :)");
 }
 void Application::initFrames() {
 	frames.resize(frameOverlap);
@@ -338,11 +807,16 @@ void Application::initFrames() {
 		frames[i].commandPool = device.createCommandPool(vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, graphicsQueueFamily));
 		frames[i].mainCommandBuffer = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(frames[i].commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
 
+		frames[i].staticCommandBuffers = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(frames[i].commandPool, vk::CommandBufferLevel::ePrimary, swapchainImages.size()));
+		frames[i].staticSceneVersions.assign(swapchainImages.size(), UINT64_MAX);
+		frames[i].staticResourceVersions.assign(swapchainImages.size(), UINT64_MAX);
+		frames[i].setupCommandBuffer = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(frames[i].commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+
 		frames[i].renderSemaphore = device.createSemaphore(vk::SemaphoreCreateInfo(vk::SemaphoreCreateFlags()));
 		frames[i].presentSemaphore = device.createSemaphore(vk::SemaphoreCreateInfo(vk::SemaphoreCreateFlags()));
 		frames[i].renderFence = device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
 
-		deletionQueue.push([=](){
+		deletionQueue.push([=, this](){
 			device.destroyCommandPool(frames[i].commandPool);
 
 			device.destroySemaphore(frames[i].presentSemaphore);
@@ -350,7 +824,7 @@ void Application::initFrames() {
 			device.destroyFence(frames[i].renderFence);
 		});
 	}
-	litelogger::logln(APPLICATION, "Frames created successfully :)");
+	asynclog::logln(APPLICATION, "Frames created successfully :)");
 }
 void Application::initVertexArray() {
 	Vertex::inputDescription.bindings = {vk::VertexInputBindingDescription(0, sizeof(Vertex), vk::VertexInputRate::eVertex)};
@@ -366,26 +840,54 @@ void Application::initVertexArray() {
 		{{ 0.0f, -1.0f}, {1.0f, 0.1f, 0.1f}}
 	};
 
-	size_t vertexBufferSize = triangleVertices.size() * sizeof(Vertex);
+	triangleIndices = {0, 1, 2};
 
-	vertexBuffer = allocator.createBuffer(
-		vk::BufferCreateInfo(vk::BufferCreateFlags(), vertexBufferSize, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst),
-		vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eCpuToGpu)
-	);
+	triangleBoundsMin = glm::vec3(INFINITY);
+	triangleBoundsMax = glm::vec3(-INFINITY);
+	for(const Vertex &v : triangleVertices) {
+		triangleBoundsMin = glm::min(triangleBoundsMin, glm::vec3(v.position, 0.0f));
+		triangleBoundsMax = glm::max(triangleBoundsMax, glm::vec3(v.position, 0.0f));
+	}
+
+	meshRegistry.create(allocator, memoryBudget.pool(MemoryBudget::STATIC_GEOMETRY), sizeof(Vertex), 64 * 1024 * 1024, 16 * 1024 * 1024);
+	triangleMesh = syncWait(loadTriangle());
+
+	// index ranges of either type stay aligned for both when moved
+	vertexArenaHandle = defragmenter.registerArena(&meshRegistry.vertexArena, sizeof(Vertex), [this](const Defragmenter::Move &move) {
+		meshRegistry.moveVertices(move.from, move.to);
+	});
+	indexArenaHandle = defragmenter.registerArena(&meshRegistry.indexArena, sizeof(uint32_t), [this](const Defragmenter::Move &move) {
+		meshRegistry.moveIndices(move.from, move.to);
+	});
+	// removed meshes can still be drawn by the frame being recorded and the ones in flight.
+	// like the defragmenter, only remove meshes on the render thread
+	meshRegistry.retire = [this](BufferArena &arena, const BufferArena::Range &range) {
+		defragmenter.retire(&arena == &meshRegistry.vertexArena ? vertexArenaHandle : indexArenaHandle, range, frame);
+	};
 
-	Vertex *data;
-	allocator.mapMemory(vertexBuffer.second, reinterpret_cast<void**>(&data));
-	memcpy(data, triangleVertices.data(), triangleVertices.size() * sizeof(Vertex));
-	allocator.unmapMemory(vertexBuffer.second);
+	meshRegistry.logStats(APPLICATION);
 
-	deletionQueue.push([=](){
-		allocator.destroyBuffer(vertexBuffer.first, vertexBuffer.second);
+	deletionQueue.push([=, this](){
+		meshRegistry.retire = nullptr;
+		defragmenter.unregister(indexArenaHandle);
+		defragmenter.unregister(vertexArenaHandle);
+
+		meshRegistry.logStats(APPLICATION);
+		meshRegistry.destroy(allocator);
 	});
 }
 void Application::initDescriptors() {
-	std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {
-		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, frameOverlap)
-	};
+	// set 0 is the per frame global set, whatever the shaders declare in it gets `frameOverlap` copies
+	std::vector<vk::DescriptorSetLayoutBinding> bindings = globalInterface.setBindings(0);
+	bool hasCamera = std::any_of(bindings.begin(), bindings.end(), [](const vk::DescriptorSetLayoutBinding &b) {
+		return b.binding == 0 && b.descriptorType == vk::DescriptorType::eUniformBuffer;
+	});
+	if(!hasCamera)
+		asynclog::exitError("Shaders don't declare the camera uniform buffer at set 0 binding 0 :(");
+
+	std::vector<vk::DescriptorPoolSize> descriptorPoolSizes;
+	for(const vk::DescriptorSetLayoutBinding &b : bindings)
+		descriptorPoolSizes.push_back(vk::DescriptorPoolSize(b.descriptorType, b.descriptorCount * frameOverlap));
 
 	descriptorPool = device.createDescriptorPool(
 		vk::DescriptorPoolCreateInfo(
@@ -396,12 +898,7 @@ void Application::initDescriptors() {
 		)
 	);
 
-	std::vector<vk::DescriptorSetLayoutBinding> bindings = {
-		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eFragment, nullptr)
-	};
-	globalSetLayout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo(
-		vk::DescriptorSetLayoutCreateFlags(), bindings.size(), bindings.data()
-	));
+	globalSetLayout = layoutCache.descriptorSetLayout(bindings);
 
 	uniformBuffer = allocator.createBuffer(
 		vk::BufferCreateInfo(vk::BufferCreateFlags(), frameOverlap * padUniformBufferSize(sizeof(CameraData)), vk::BufferUsageFlagBits::eUniformBuffer),
@@ -411,39 +908,158 @@ void Application::initDescriptors() {
 	for(uint8_t i = 0; i < frameOverlap; i++) {
 		frames[i].globalDescriptorSet = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool, 1, &globalSetLayout))[0];
 
-		vk::DescriptorBufferInfo cameraDescriptorBufferInfo(uniformBuffer.first, padUniformBufferSize(sizeof(CameraData)), sizeof(CameraData));
+		vk::DescriptorBufferInfo cameraDescriptorBufferInfo(uniformBuffer.first, padUniformBufferSize(sizeof(CameraData)) * i, sizeof(CameraData));
 
 		vk::WriteDescriptorSet cameraWrite(frames[i].globalDescriptorSet, 0, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &cameraDescriptorBufferInfo);
 
 		device.updateDescriptorSets(1, &cameraWrite, 0, nullptr);
 	}
 
-	deletionQueue.push([=](){
-		device.destroyDescriptorSetLayout(globalSetLayout);
+	allocator.mapMemory(uniformBuffer.second, reinterpret_cast<void**>(&uniformData));
+
+	deletionQueue.push([=, this](){
 		device.destroyDescriptorPool(descriptorPool);
 
+		allocator.unmapMemory(uniformBuffer.second);
 		allocator.destroyBuffer(uniformBuffer.first, uniformBuffer.second);
 	});
 
-	litelogger::logln(APPLICATION, "Descriptors created successfully :)");
+	asynclog::logln(APPLICATION, "Descriptors created successfully :)");
 }
-void Application::initGraphicsPipeline() {
-	std::vector<char> vertShaderCode = readFile("res/shaders/triangle.vert.spv");
-	std::vector<char> fragShaderCode = readFile("res/shaders/triangle.frag.spv");
+void Application::initAssets() {
+	const char *path = config::get("VKENGINE_ASSETS", "assets.pack");
+	if(!assets.open(path))
+		asynclog::exitError("Failed to open asset pack %s, build the `assets` target :(", path);
+
+	vertShaderCode = assets.view("shaders/triangle.vert.spv");
+	fragShaderCode = assets.view((std::string("shaders/") + fragShaderName + ".spv").c_str());
+	if(!vertShaderCode || !fragShaderCode)
+		asynclog::exitError("Shaders are missing from %s :(", path);
+
+	ShaderReflection fragInterface;
+	std::string error;
+	if(!shaderInterface.reflect(reinterpret_cast<const uint32_t*>(vertShaderCode.data), vertShaderCode.size, error)
+	|| !fragInterface.reflect(reinterpret_cast<const uint32_t*>(fragShaderCode.data), fragShaderCode.size, error)
+	|| !shaderInterface.merge(fragInterface, error))
+		asynclog::exitError("Failed to reflect the shaders: %s :(", error.c_str());
+
+	if(shading == DEFERRED) {
+		lightingVertShaderCode = assets.view("shaders/deferred_light.vert.spv");
+		lightingFragShaderCode = assets.view("shaders/deferred_light.frag.spv");
+		if(!lightingVertShaderCode || !lightingFragShaderCode)
+			asynclog::exitError("Lighting shaders are missing from %s :(", path);
+
+		ShaderReflection lightingFragInterface;
+		if(!lightingInterface.reflect(reinterpret_cast<const uint32_t*>(lightingVertShaderCode.data), lightingVertShaderCode.size, error)
+		|| !lightingFragInterface.reflect(reinterpret_cast<const uint32_t*>(lightingFragShaderCode.data), lightingFragShaderCode.size, error)
+		|| !lightingInterface.merge(lightingFragInterface, error))
+			asynclog::exitError("Failed to reflect the lighting shaders: %s :(", error.c_str());
+	}
+
+	cullShaderCode = assets.view("shaders/cluster_cull.comp.spv");
+	if(!cullShaderCode)
+		asynclog::exitError("Light culling shader is missing from %s :(", path);
+
+	// the culling dispatch and the lighting subpass bind the same global set as the draws
+	ShaderReflection cullInterface;
+	globalInterface = shaderInterface;
+	if(!cullInterface.reflect(reinterpret_cast<const uint32_t*>(cullShaderCode.data), cullShaderCode.size, error)
+	|| !globalInterface.merge(cullInterface, error)
+	|| (shading == DEFERRED && !globalInterface.merge(lightingInterface, error)))
+		asynclog::exitError("Global set declared differently between shaders: %s :(", error.c_str());
+
+	if(occlusionMode == HIZ_OCCLUSION) {
+		hizShaderCode = assets.view("shaders/hiz_build.comp.spv");
+		occlusionShaderCode = assets.view("shaders/occlusion_cull.comp.spv");
+		if(!hizShaderCode || !occlusionShaderCode)
+			asynclog::exitError("Occlusion culling shaders are missing from %s :(", path);
+		if(!hizInterface.reflect(reinterpret_cast<const uint32_t*>(hizShaderCode.data), hizShaderCode.size, error)
+		|| !occlusionInterface.reflect(reinterpret_cast<const uint32_t*>(occlusionShaderCode.data), occlusionShaderCode.size, error))
+			asynclog::exitError("Failed to reflect the occlusion culling shaders: %s :(", error.c_str());
+		// the culling reads the cameras from the global set
+		if(!globalInterface.merge(occlusionInterface, error))
+			asynclog::exitError("Global set declared differently between shaders: %s :(", error.c_str());
+	}
+
+	shadowShaderCode = assets.view("shaders/shadow.vert.spv");
+	if(!shadowShaderCode)
+		asynclog::exitError("Shadow shader is missing from %s :(", path);
+	if(!shadowInterface.reflect(reinterpret_cast<const uint32_t*>(shadowShaderCode.data), shadowShaderCode.size, error))
+		asynclog::exitError("Failed to reflect the shadow shader: %s :(", error.c_str());
+
+	deletionQueue.push([=, this]() {
+		assets.close();
+	});
+
+	asynclog::logln(APPLICATION, "Opened asset pack with %u entries :)", assets.header->entryCount);
+}
+void Application::initAssetLoader() {
+	// leave a core for the main and render threads
+	uint32_t workers = std::clamp<long>(config::getInt("VKENGINE_WORKERS", std::max(std::thread::hardware_concurrency(), 3u) - 2), 1, std::max(std::thread::hardware_concurrency(), 1u));
+
+	loader.create(device, allocator, memoryBudget.pool(MemoryBudget::STAGING), transferQueue, transferQueueFamily, &transferQueueMutex, &assets, workers);
 
-	vk::ShaderModule vertShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
-		vertShaderCode.size(), reinterpret_cast<const uint32_t*>(vertShaderCode.data()
+	deletionQueue.push([=, this]() {
+		loader.destroy();
+	});
+
+	asynclog::logln(APPLICATION, "Asset loader started with %u workers :)", workers);
+}
+void Application::initGraphicsPipeline() {
+	vertShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		vertShaderCode.size, reinterpret_cast<const uint32_t*>(vertShaderCode.data
 	)));
-	vk::ShaderModule fragShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
-		fragShaderCode.size(), reinterpret_cast<const uint32_t*>(fragShaderCode.data()
+	fragShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		fragShaderCode.size, reinterpret_cast<const uint32_t*>(fragShaderCode.data
 	)));
 
+	if(shaderInterface.setCount() > 1)
+		asynclog::exitError("Shaders use %u descriptor sets, only the global one is bound :(", shaderInterface.setCount());
+	// draws push all of `PushConstants`, which has to be exactly what the layout declares for every stage using them
+	for(const vk::PushConstantRange &r : shaderInterface.pushConstantRanges)
+		if(r.offset != 0 || r.size != sizeof(PushConstants))
+			asynclog::exitError("Shaders declare push constants at bytes %u to %u, but %zu bytes are pushed from 0 :(", r.offset, r.offset + r.size, sizeof(PushConstants));
+	pushConstantStages = shaderInterface.pushConstantStages(0, sizeof(PushConstants));
+
+	// the vertex layout comes from `Vertex`, the shader only says what it has to look like
+	for(const ShaderReflection::VertexInput &input : shaderInterface.vertexInputs) {
+		auto attribute = std::find_if(Vertex::inputDescription.attributes.begin(), Vertex::inputDescription.attributes.end(), [&](const vk::VertexInputAttributeDescription &a) {
+			return a.location == input.location;
+		});
+		if(attribute == Vertex::inputDescription.attributes.end() || attribute->format != input.format)
+			asynclog::exitError("Vertex shader input %u doesn't match `Vertex` (expected %s) :(", input.location, vk::to_string(input.format).c_str());
+	}
+
+	pipelineLayout = layoutCache.pipelineLayout({globalSetLayout}, shaderInterface.pushConstantRanges);
+
+	pipelineCache = device.createPipelineCache(vk::PipelineCacheCreateInfo());
+
+	// variants are specialized from the same modules, so they stay around as long as the pipelines might be rebuilt
+	pipelines.create(device, shaderInterface.specializationConstants, [this, vert = vertShaderModule, frag = fragShaderModule](const vk::SpecializationInfo &specialization) {
+		return buildPipeline(vert, frag, specialization);
+	});
+	// every variant the scene draws with, recording a frame never has to compile one
+	pipelines.prebuild(1u << TRIANGLE_FEATURES);
+
+	deletionQueue.push([=, this](){
+		pipelines.destroy();
+		device.destroyShaderModule(fragShaderModule);
+		device.destroyShaderModule(vertShaderModule);
+		device.destroyPipelineCache(pipelineCache);
+	});
+
+	if(const char *reload = config::get("VKENGINE_SHADER_RELOAD", nullptr); reload && strcmp(reload, "0") != 0)
+		startShaderHotReload(strcmp(reload, "1") == 0 ? VKENGINE_SHADER_SOURCE_DIR : reload);
+
+	asynclog::logln(APPLICATION, "Graphics pipeline created successfully, shaders declare features 0x%x :)", shaderInterface.specializationConstants);
+}
+vk::Pipeline Application::buildPipeline(vk::ShaderModule vert, vk::ShaderModule frag, const vk::SpecializationInfo &specialization) {
 	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
 		vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
-			vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main", nullptr
+			vk::ShaderStageFlagBits::eVertex, vert, "main", &specialization
 		),
 		vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
-			vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", nullptr
+			vk::ShaderStageFlagBits::eFragment, frag, "main", &specialization
 		)
 	};
 
@@ -454,8 +1070,8 @@ void Application::initGraphicsPipeline() {
 
 	vk::PipelineInputAssemblyStateCreateInfo inputAssembly(vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList, VK_FALSE);
 
-	vk::Viewport viewport(0,0, swapchainExtent.width, swapchainExtent.height, 0, 1);
-	vk::Rect2D scissor({0, 0}, swapchainExtent);
+	vk::Viewport viewport(0,0, renderExtent.width, renderExtent.height, 0, 1);
+	vk::Rect2D scissor({0, 0}, renderExtent);
 
 	vk::PipelineViewportStateCreateInfo viewportState(vk::PipelineViewportStateCreateFlags(),
 		1, &viewport,
@@ -491,29 +1107,129 @@ void Application::initGraphicsPipeline() {
 		vk::BlendOp::eAdd,
 		vk::ColorComponentFlags(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
 	);
+	// the geometry subpass of deferred shading writes albedo and normals
+	std::vector<vk::PipelineColorBlendAttachmentState> colorBlendAttachments(shading == DEFERRED ? 2 : 1, colorBlendAttachment);
 	vk::PipelineColorBlendStateCreateInfo colorBlend(vk::PipelineColorBlendStateCreateFlags(),
 		VK_FALSE,
 		vk::LogicOp::eCopy,
-		1,
-		&colorBlendAttachment,
+		colorBlendAttachments.size(),
+		colorBlendAttachments.data(),
 		{0.0f, 0.0f, 0.0f, 0.0f}
 	);
 
+	// forward shading's depth buffer is only there for the draws themselves and the occlusion pyramid
+	vk::PipelineDepthStencilStateCreateInfo depthStencil(vk::PipelineDepthStencilStateCreateFlags(),
+		VK_TRUE,
+		VK_TRUE,
+		vk::CompareOp::eLess,
+		VK_FALSE,
+		VK_FALSE,
+		vk::StencilOpState(),
+		vk::StencilOpState(),
+		0.0f,
+		1.0f
+	);
+
 	std::vector<vk::DynamicState> dynamicStates = {};
 	vk::PipelineDynamicStateCreateInfo dynamicState(vk::PipelineDynamicStateCreateFlags(), dynamicStates.size(), dynamicStates.data());
 
-	std::vector<vk::PushConstantRange> pushConstants = {
-		vk::PushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants))
+	vk::GraphicsPipelineCreateInfo pipelineCreateInfo(vk::PipelineCreateFlags(),
+		shaderStages.size(),
+		shaderStages.data(),
+		&vertexInputInfo,
+		&inputAssembly,
+		nullptr, // tesselation
+		&viewportState,
+		&rasterizer,
+		&multisampling,
+		&depthStencil,
+		&colorBlend,
+		&dynamicState,
+		pipelineLayout,
+		renderPass,
+		0, // the geometry subpass with deferred shading
+		VK_NULL_HANDLE,
+		-1
+	);
+
+	// without a render pass the attachment formats are declared on the pipeline instead
+	uint32_t viewMask = viewCount > 1 ? (1u << viewCount) - 1 : 0;
+	vk::PipelineRenderingCreateInfoKHR renderingInfo(viewMask, 1, &swapchainImageFormat, depthFormat, vk::Format::eUndefined);
+	if(renderPath == DYNAMIC_RENDERING)
+		pipelineCreateInfo.pNext = &renderingInfo;
+
+	return device.createGraphicsPipeline(pipelineCache, pipelineCreateInfo).value;
+}
+void Application::initLightingPass() {
+	if(shading != DEFERRED)
+		return;
+
+	// set 0 is the global set, the G-buffer inputs are set 1
+	for(const ShaderReflection::Binding &b : lightingInterface.bindings) {
+		if(b.set == 1 && b.binding < GBuffer::ATTACHMENT_COUNT && b.type == vk::DescriptorType::eInputAttachment && b.count == 1)
+			continue;
+		auto global = std::find_if(globalInterface.bindings.begin(), globalInterface.bindings.end(), [&](const ShaderReflection::Binding &g) {
+			return g.set == b.set && g.binding == b.binding;
+		});
+		if(b.set != 0 || global == globalInterface.bindings.end() || global->type != b.type || (global->stages & b.stages) != b.stages)
+			asynclog::exitError("Lighting shaders declare set %u binding %u, which isn't a G-buffer input or in the global set :(", b.set, b.binding);
+	}
+	if(!lightingInterface.vertexInputs.empty() || !lightingInterface.pushConstantRanges.empty())
+		asynclog::exitError("Lighting shaders can't have vertex inputs or push constants :(");
+
+	std::vector<vk::DescriptorSetLayoutBinding> gbufferBindings;
+	for(uint32_t a = 0; a < GBuffer::ATTACHMENT_COUNT; a++)
+		gbufferBindings.push_back(vk::DescriptorSetLayoutBinding(a, vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment));
+	gbufferSetLayout = layoutCache.descriptorSetLayout(gbufferBindings);
+	gbuffer.createDescriptorSet(gbufferSetLayout);
+
+	lightingPipelineLayout = layoutCache.pipelineLayout({globalSetLayout, gbufferSetLayout}, {});
+
+	lightingVertShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		lightingVertShaderCode.size, reinterpret_cast<const uint32_t*>(lightingVertShaderCode.data)
+	));
+	lightingFragShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		lightingFragShaderCode.size, reinterpret_cast<const uint32_t*>(lightingFragShaderCode.data)
+	));
+
+	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages = {
+		vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, lightingVertShaderModule, "main"),
+		vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, lightingFragShaderModule, "main")
 	};
 
-	pipelineLayout = device.createPipelineLayout(vk::PipelineLayoutCreateInfo(vk::PipelineLayoutCreateFlags(),
+	// one triangle covering the screen, positions come from `gl_VertexIndex`
+	vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly(vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList, VK_FALSE);
+
+	vk::Viewport viewport(0,0, renderExtent.width, renderExtent.height, 0, 1);
+	vk::Rect2D scissor({0, 0}, renderExtent);
+	vk::PipelineViewportStateCreateInfo viewportState(vk::PipelineViewportStateCreateFlags(),
+		1, &viewport,
+		1, &scissor
+	);
+
+	vk::PipelineRasterizationStateCreateInfo rasterizer(vk::PipelineRasterizationStateCreateFlags(),
+		VK_FALSE,
+		VK_FALSE,
+		vk::PolygonMode::eFill,
+		vk::CullModeFlagBits::eNone,
+		vk::FrontFace::eCounterClockwise,
+		VK_FALSE, 0.0f, 0.0f, 0.0f,
+		1.0f
+	);
+	vk::PipelineMultisampleStateCreateInfo multisampling(vk::PipelineMultisampleStateCreateFlags(), vk::SampleCountFlagBits::e1);
+
+	vk::PipelineColorBlendAttachmentState colorBlendAttachment(VK_FALSE);
+	colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+	vk::PipelineColorBlendStateCreateInfo colorBlend(vk::PipelineColorBlendStateCreateFlags(),
+		VK_FALSE,
+		vk::LogicOp::eCopy,
 		1,
-		&globalSetLayout,
-		pushConstants.size(),
-		pushConstants.data()
-	));
+		&colorBlendAttachment,
+		{0.0f, 0.0f, 0.0f, 0.0f}
+	);
 
-	pipeline = device.createGraphicsPipeline(VK_NULL_HANDLE, vk::GraphicsPipelineCreateInfo(vk::PipelineCreateFlags(),
+	lightingPipeline = device.createGraphicsPipeline(pipelineCache, vk::GraphicsPipelineCreateInfo(vk::PipelineCreateFlags(),
 		shaderStages.size(),
 		shaderStages.data(),
 		&vertexInputInfo,
@@ -522,82 +1238,698 @@ void Application::initGraphicsPipeline() {
 		&viewportState,
 		&rasterizer,
 		&multisampling,
-		nullptr, // depth stencil
+		nullptr, // depth stencil, depth is only read as an input attachment
 		&colorBlend,
-		&dynamicState,
-		pipelineLayout,
+		nullptr, // dynamic state
+		lightingPipelineLayout,
 		renderPass,
-		0,
+		1,
 		VK_NULL_HANDLE,
 		-1
 	)).value;
 
-	deletionQueue.push([=](){
-		device.destroyPipeline(pipeline);
-		device.destroyPipelineLayout(pipelineLayout);
+	deletionQueue.push([=, this](){
+		device.destroyPipeline(lightingPipeline);
+		device.destroyShaderModule(lightingFragShaderModule);
+		device.destroyShaderModule(lightingVertShaderModule);
 	});
 
-	device.destroyShaderModule(fragShaderModule);
-	device.destroyShaderModule(vertShaderModule);
+	asynclog::logln(APPLICATION, "Lighting pass created successfully :)");
+}
+void Application::initLightCulling() {
+	for(uint32_t binding : {1u, 2u}) {
+		auto b = std::find_if(globalInterface.bindings.begin(), globalInterface.bindings.end(), [&](const ShaderReflection::Binding &g) {
+			return g.set == 0 && g.binding == binding;
+		});
+		if(b == globalInterface.bindings.end() || b->type != vk::DescriptorType::eStorageBuffer)
+			asynclog::exitError("Shaders don't declare the light buffers at set 0 binding %u :(", binding);
+	}
 
-	litelogger::logln(APPLICATION, "Graphics pipeline created successfully :)");
+	lightCulling.create(device, allocator, frameOverlap, viewCount, physicalDeviceProperties.limits.minStorageBufferOffsetAlignment, validateClusters);
+
+	for(uint8_t i = 0; i < frameOverlap; i++) {
+		vk::DescriptorBufferInfo lightInfo = lightCulling.lightBufferInfo(i);
+		vk::DescriptorBufferInfo clusterInfo = lightCulling.clusterBufferInfo(i);
+		std::array<vk::WriteDescriptorSet, 2> writes = {
+			vk::WriteDescriptorSet(frames[i].globalDescriptorSet, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &lightInfo),
+			vk::WriteDescriptorSet(frames[i].globalDescriptorSet, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &clusterInfo)
+		};
+		device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+	}
+
+	cullShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		cullShaderCode.size, reinterpret_cast<const uint32_t*>(cullShaderCode.data)
+	));
+	lightCulling.createPipeline(cullShaderModule, layoutCache.pipelineLayout({globalSetLayout}, {}), pipelineCache);
+
+	deletionQueue.push([=, this](){
+		lightCulling.destroy();
+		device.destroyShaderModule(cullShaderModule);
+	});
+
+	asynclog::logln(APPLICATION, "Light culling created successfully, %u lights in %u clusters per view :)", lightCount, clusters::COUNT);
 }
-void Application::input() {
+void Application::initShadows() {
+	auto atlas = std::find_if(globalInterface.bindings.begin(), globalInterface.bindings.end(), [](const ShaderReflection::Binding &g) {
+		return g.set == 0 && g.binding == 3;
+	});
+	if(atlas == globalInterface.bindings.end() || atlas->type != vk::DescriptorType::eCombinedImageSampler)
+		asynclog::exitError("Shaders don't declare the shadow atlas at set 0 binding 3 :(");
+	if(!shadowInterface.bindings.empty())
+		asynclog::exitError("The shadow shader can't use descriptors, everything it needs is pushed :(");
+	for(const vk::PushConstantRange &r : shadowInterface.pushConstantRanges)
+		if(r.offset != 0 || r.size != sizeof(PushConstants))
+			asynclog::exitError("The shadow shader declares push constants at bytes %u to %u, but %zu bytes are pushed from 0 :(", r.offset, r.offset + r.size, sizeof(PushConstants));
 
+	uint32_t resolution = std::clamp<long>(config::getInt("VKENGINE_SHADOW_RESOLUTION", 1024), 256, 4096);
+	shadows.create(device, physicalDevice, allocator, resolution);
+
+	for(uint8_t i = 0; i < frameOverlap; i++) {
+		vk::DescriptorImageInfo atlasInfo(shadows.sampler, shadows.view, vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+		vk::WriteDescriptorSet atlasWrite(frames[i].globalDescriptorSet, 3, 0, 1, vk::DescriptorType::eCombinedImageSampler, &atlasInfo, nullptr, nullptr);
+		device.updateDescriptorSets(1, &atlasWrite, 0, nullptr);
+	}
+
+	shadowShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		shadowShaderCode.size, reinterpret_cast<const uint32_t*>(shadowShaderCode.data)
+	));
+	shadowPipelineLayout = layoutCache.pipelineLayout({}, shadowInterface.pushConstantRanges);
+
+	// same vertex buffer as the draws, the shader just ignores the colors
+	vk::PipelineVertexInputStateCreateInfo vertexInput(Vertex::inputDescription.flags,
+		Vertex::inputDescription.bindings.size(), Vertex::inputDescription.bindings.data(),
+		Vertex::inputDescription.attributes.size(), Vertex::inputDescription.attributes.data()
+	);
+	shadows.createPipeline(shadowShaderModule, shadowPipelineLayout, vertexInput, pipelineCache);
+
+	deletionQueue.push([=, this](){
+		asynclog::logln(APPLICATION, "Redrew %llu shadow cascades in %llu frames :)", static_cast<unsigned long long>(shadows.refreshes), static_cast<unsigned long long>(frame));
+		shadows.destroy();
+		device.destroyShaderModule(shadowShaderModule);
+	});
+
+	asynclog::logln(APPLICATION, "Shadows created successfully, %u cascades of %ux%u in %s :)", cascades::COUNT, resolution, resolution, vk::to_string(shadows.format).c_str());
 }
-void Application::render() {
-	glfwPollEvents();
+void Application::initOcclusionCulling() {
+	if(occlusionMode == CPU_OCCLUSION) {
+		uint32_t threads = std::clamp<long>(config::getInt("VKENGINE_OCCLUSION_THREADS", 2), 0, std::thread::hardware_concurrency());
+		softwareOcclusion.create(viewCount, threads);
+
+		// the triangle is its own occluder, it's about as low poly as it gets
+		SoftwareOcclusion::Mesh occluder;
+		for(const Vertex &v : triangleVertices)
+			occluder.positions.push_back(glm::vec3(v.position, 0.0f));
+		occluder.indices.assign(triangleIndices.begin(), triangleIndices.end());
+		triangleOccluder = softwareOcclusion.addMesh(std::move(occluder));
+
+		deletionQueue.push([=, this](){
+			asynclog::logln(APPLICATION, "Software occlusion culled %llu of %llu boxes :)", static_cast<unsigned long long>(softwareOcclusion.culled), static_cast<unsigned long long>(softwareOcclusion.tested));
+			softwareOcclusion.destroy();
+		});
 
-	Frame &f = getCurrentFrame();
+		asynclog::logln(APPLICATION, "Software occlusion created successfully, %ux%u on %u threads%s :)", SoftwareOcclusion::WIDTH, SoftwareOcclusion::HEIGHT, threads, softwareOcclusion.avx2 ? " with AVX2" : "");
+		return;
+	}
+	if(occlusionMode != HIZ_OCCLUSION)
+		return;
 
-	device.waitForFences(1, &f.renderFence, true, UINT64_MAX);
-	device.resetFences(1, &f.renderFence);
+	if(hizInterface.setCount() != 1 || !hizInterface.pushConstantRanges.empty())
+		asynclog::exitError("The pyramid build shader can only use set 0 :(");
+	if(occlusionInterface.setCount() != 2)
+		asynclog::exitError("The occlusion culling shader has to use the global set and set 1 :(");
 
-	uint32_t swapchainImageIndex = device.acquireNextImageKHR(swapchain, 1000000000, f.presentSemaphore, nullptr);
+	occlusion.create(device, allocator, frameOverlap, depthImage.first, depthFormat, renderExtent, viewCount, physicalDeviceProperties.limits.minStorageBufferOffsetAlignment);
 
-	f.mainCommandBuffer.reset(vk::CommandBufferResetFlags());
-	f.mainCommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr));
+	hizShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		hizShaderCode.size, reinterpret_cast<const uint32_t*>(hizShaderCode.data)
+	));
+	occlusionShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		occlusionShaderCode.size, reinterpret_cast<const uint32_t*>(occlusionShaderCode.data)
+	));
 
-	std::array<vk::ClearValue, 1> clearValues = {vk::ClearColorValue(std::array<float, 4>{1.0f, 0.3f, 1.0f, 1.0f})};
-	f.mainCommandBuffer.beginRenderPass(vk::RenderPassBeginInfo(
-		renderPass, swapchainFramebuffers[swapchainImageIndex], vk::Rect2D(vk::Offset2D(), swapchainExtent), clearValues), vk::SubpassContents::eInline
+	vk::DescriptorSetLayout buildSetLayout = layoutCache.descriptorSetLayout(hizInterface.setBindings(0));
+	vk::DescriptorSetLayout cullSetLayout = layoutCache.descriptorSetLayout(occlusionInterface.setBindings(1));
+	occlusion.createPipelines(
+		hizShaderModule, buildSetLayout, layoutCache.pipelineLayout({buildSetLayout}, {}),
+		occlusionShaderModule, cullSetLayout, layoutCache.pipelineLayout({globalSetLayout, cullSetLayout}, occlusionInterface.pushConstantRanges),
+		pipelineCache
 	);
 
-	CameraData cameraData{
-		.cameraPosition = glm::vec3(std::sin(frame/20.0f)/2.0f+0.5f, std::cos(frame/20.0f)/2.0f+0.5f, 0.0f)
+	deletionQueue.push([=, this](){
+		occlusion.destroy();
+		device.destroyShaderModule(occlusionShaderModule);
+		device.destroyShaderModule(hizShaderModule);
+	});
+
+	asynclog::logln(APPLICATION, "Occlusion culling created successfully, %ux%u pyramid with %u levels :)", occlusion.pyramidExtent.width, occlusion.pyramidExtent.height, occlusion.levelCount);
+}
+void Application::startShaderHotReload(const char *directory) {
+	const uint32_t *vert = reinterpret_cast<const uint32_t*>(vertShaderCode.data);
+	const uint32_t *frag = reinterpret_cast<const uint32_t*>(fragShaderCode.data);
+	vertShaderSource.assign(vert, vert + vertShaderCode.size / sizeof(uint32_t));
+	fragShaderSource.assign(frag, frag + fragShaderCode.size / sizeof(uint32_t));
+
+	if(!shaderHotReload.start(directory, config::get("VKENGINE_GLSLC", VKENGINE_GLSLC), [this](const std::string &name, std::vector<uint32_t> &&code) {
+		reloadShader(name, std::move(code));
+	})) {
+		asynclog::logln(litelogger::WARN, "Can't watch %s, shader hot reload is off", directory);
+		return;
+	}
+
+	// runs before the pipelines are destroyed, nothing gets swapped in after this
+	deletionQueue.push([=, this](){
+		shaderHotReload.stop();
+		if(pendingShaderReload)
+			destroyShaderReload(*pendingShaderReload);
+		for(std::unique_ptr<ShaderReload> &r : retiredShaderReloads)
+			destroyShaderReload(*r);
+		pendingShaderReload.reset();
+		retiredShaderReloads.clear();
+	});
+}
+void Application::reloadShader(const std::string &name, std::vector<uint32_t> &&code) {
+	if(name == "triangle.vert")
+		vertShaderSource = std::move(code);
+	else if(name == fragShaderName)
+		fragShaderSource = std::move(code);
+	else
+		return; // no pipeline uses it
+
+	ShaderReflection reloaded, fragInterface;
+	std::string error;
+	if(!reloaded.reflect(vertShaderSource.data(), vertShaderSource.size() * sizeof(uint32_t), error)
+	|| !fragInterface.reflect(fragShaderSource.data(), fragShaderSource.size() * sizeof(uint32_t), error)
+	|| !reloaded.merge(fragInterface, error)) {
+		asynclog::logln(litelogger::ERROR, "Failed to reflect %s: %s :(", name.c_str(), error.c_str());
+		return;
+	}
+	// descriptor sets, push constants and vertex buffers are set up once, anything else needs a restart
+	if(!reloaded.sameLayout(shaderInterface)) {
+		asynclog::logln(litelogger::ERROR, "%s changes the pipeline layout or vertex inputs, restart to pick it up :(", name.c_str());
+		return;
+	}
+
+	// modules and pipelines are built right here on the watcher thread, the render thread only swaps them in
+	std::unique_ptr<ShaderReload> reload = std::make_unique<ShaderReload>();
+	reload->vertShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		vertShaderSource.size() * sizeof(uint32_t), vertShaderSource.data()
+	));
+	reload->fragShaderModule = device.createShaderModule(vk::ShaderModuleCreateInfo(vk::ShaderModuleCreateFlags(),
+		fragShaderSource.size() * sizeof(uint32_t), fragShaderSource.data()
+	));
+	reload->pipelines = std::make_unique<PipelineVariants>();
+	reload->pipelines->create(device, reloaded.specializationConstants, [this, vert = reload->vertShaderModule, frag = reload->fragShaderModule](const vk::SpecializationInfo &specialization) {
+		return buildPipeline(vert, frag, specialization);
+	});
+	reload->pipelines->prebuild(pipelines.builtKeys());
+
+	{
+		std::lock_guard<std::mutex> lock(shaderReloadMutex);
+		if(pendingShaderReload) // never swapped in, nothing can be using it
+			destroyShaderReload(*pendingShaderReload);
+		pendingShaderReload = std::move(reload);
+	}
+	redraw.request(RedrawTracker::RESOURCES);
+}
+void Application::applyShaderReload() {
+	// replaced variants may still be bound by frames in flight
+	for(size_t i = 0; i < retiredShaderReloads.size();) {
+		if(frame < retiredShaderReloads[i]->retiredFrame + frameOverlap) {
+			i++;
+			continue;
+		}
+		destroyShaderReload(*retiredShaderReloads[i]);
+		retiredShaderReloads.erase(retiredShaderReloads.begin() + i);
+	}
+
+	std::unique_ptr<ShaderReload> reload;
+	{
+		std::lock_guard<std::mutex> lock(shaderReloadMutex);
+		reload = std::move(pendingShaderReload);
+	}
+	if(!reload)
+		return;
+
+	pipelines.swap(*reload->pipelines);
+	std::swap(vertShaderModule, reload->vertShaderModule);
+	std::swap(fragShaderModule, reload->fragShaderModule);
+	reload->retiredFrame = frame;
+	retiredShaderReloads.push_back(std::move(reload));
+
+	resourceVersion++; // pre-recorded command buffers still bind the old pipelines
+	asynclog::logln(APPLICATION, "Swapped in reloaded shaders at frame %llu", (unsigned long long) frame);
+}
+void Application::destroyShaderReload(ShaderReload &reload) {
+	reload.pipelines->destroy();
+	device.destroyShaderModule(reload.fragShaderModule);
+	device.destroyShaderModule(reload.vertShaderModule);
+}
+Task<MeshRegistry::MeshHandle> Application::loadTriangle() {
+	// ranges are reserved right away, the data arrives through the transfer queue
+	MeshRegistry::MeshHandle mesh = meshRegistry.reserve(triangleVertices.size(), triangleIndices.size(), vk::IndexType::eUint16);
+	MeshRegistry::Mesh m = meshRegistry.get(mesh);
+
+	co_await loader.upload(meshRegistry.vertexArena.buffer, m.vertexRange.offset, triangleVertices.data(), triangleVertices.size() * sizeof(Vertex));
+	co_await loader.upload(meshRegistry.indexArena.buffer, m.indexRange.offset, triangleIndices.data(), triangleIndices.size() * sizeof(uint16_t));
+	co_return mesh;
+}
+/// world space box around a transformed local one
+static void transformBounds(const glm::mat4 &transform, glm::vec3 min, glm::vec3 max, glm::vec3 &worldMin, glm::vec3 &worldMax) {
+	glm::vec3 center = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.0f));
+	glm::vec3 half = (max - min) * 0.5f;
+	glm::vec3 extent(0.0f);
+	for(uint32_t axis = 0; axis < 3; axis++)
+		for(uint32_t i = 0; i < 3; i++)
+			extent[axis] += std::abs(transform[i][axis]) * half[i];
+	worldMin = center - extent;
+	worldMax = center + extent;
+}
+void Application::input(RenderPacket &packet) {
+	packet.frame = simulationFrame;
+	packet.sceneVersion = sceneVersion;
+	packet.visibilityVersion = visibilityVersion;
+	packet.cameraData = {
+		.cameraPosition = glm::vec3(std::sin(animationFrame/20.0f)/2.0f+0.5f, std::cos(animationFrame/20.0f)/2.0f+0.5f, 0.0f)
 	};
+	CameraData &camera = packet.cameraData;
+	camera.sunDirection = glm::normalize(glm::vec3(0.3f, 0.6f, 1.0f));
+	camera.sunColor = glm::vec3(1.0f, 0.95f, 0.85f);
+	camera.zNear = 0.1f;
+	camera.zFar = 100.0f;
+	camera.viewportSize = glm::vec2(renderExtent.width, renderExtent.height);
+
+	// Vulkan's clip space as is: y down, z forward, depth from 0 at `zNear` to 1 at `zFar`, 90 degrees vertically
+	float aspect = camera.viewportSize.x / camera.viewportSize.y;
+	camera.projection = glm::mat4(0.0f);
+	camera.projection[0][0] = 1.0f / aspect;
+	camera.projection[1][1] = 1.0f;
+	camera.projection[2][2] = camera.zFar / (camera.zFar - camera.zNear);
+	camera.projection[2][3] = 1.0f;
+	camera.projection[3][2] = -camera.zNear * camera.zFar / (camera.zFar - camera.zNear);
+	camera.inverseProjection = glm::inverse(camera.projection);
+
+	// views are spread around the scene like a stereo rig, a single view looks straight at it from one unit away
+	for(uint32_t v = 0; v < viewCount; v++) {
+		float angle = (v - (viewCount - 1) / 2.0f) * 0.3f;
+		camera.view[v] = glm::rotate(glm::translate(glm::mat4(1), glm::vec3(0.0f, 0.0f, 1.0f)), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+		camera.inverseView[v] = glm::inverse(camera.view[v]);
+		camera.viewProjection[v] = camera.projection * camera.view[v];
+	}
 
-	uint8_t *data;
-	uint32_t offset = padUniformBufferSize(sizeof(CameraData)) * f.index;
-	allocator.mapMemory(uniformBuffer.second, reinterpret_cast<void**>(&data));
-	memcpy(data + offset, &cameraData, sizeof(CameraData));
-	allocator.unmapMemory(uniformBuffer.second);
+	// the big triangle is static scenery, the small one in front of it is drawn as dynamic to cast a shadow on it
+	std::vector<SoftwareOcclusion::Occluder> occluders;
+	auto draw = [&](const glm::mat4 &transform, bool dynamic, bool occluder) {
+		Draw d = {triangleMesh, TRIANGLE_FEATURES, {transform}, dynamic};
+		transformBounds(transform, triangleBoundsMin, triangleBoundsMax, d.boundsMin, d.boundsMax);
+		packet.draws.push_back(d);
+		if(occluder && occlusionMode == CPU_OCCLUSION)
+			occluders.push_back({triangleOccluder, transform});
+	};
+	draw(glm::mat4(1), false, true);
+	draw(glm::scale(glm::translate(glm::mat4(1), glm::vec3(0.3f, 0.2f, -0.3f)), glm::vec3(0.25f)), true, false);
+	// hidden behind the big one, for occlusion culling to skip
+	draw(glm::scale(glm::translate(glm::mat4(1), glm::vec3(0.0f, 0.3f, 0.5f)), glm::vec3(0.3f)), false, false);
+
+	// no GPU round trip, so this packet's draws are culled against this packet's cameras
+	if(occlusionMode == CPU_OCCLUSION) {
+		softwareOcclusion.render(camera.viewProjection, camera.zNear, occluders);
+		bool changed = softwareOccluded.size() != packet.draws.size();
+		softwareOccluded.resize(packet.draws.size());
+		for(size_t i = 0; i < packet.draws.size(); i++) {
+			Draw &d = packet.draws[i];
+			d.occluded = !softwareOcclusion.visible(d.boundsMin, d.boundsMax);
+			changed = changed || softwareOccluded[i] != d.occluded;
+			softwareOccluded[i] = d.occluded;
+		}
+		// only the main pass skips occluded draws, the shadow cache stays valid
+		if(changed)
+			packet.visibilityVersion = ++visibilityVersion;
+	}
+
+	// demo lights on a slowly turning spiral just in front of the triangle
+	packet.lights.resize(lightCount);
+	for(uint32_t i = 0; i < lightCount; i++) {
+		float r = std::sqrt((i + 0.5f) / lightCount);
+		float theta = i * 2.399963f + animationFrame / 100.0f; // golden angle
+		glm::vec3 hue = 0.5f + 0.5f * glm::cos(6.283185f * (i * 0.618034f + glm::vec3(0.0f, 0.33f, 0.67f)));
+		packet.lights[i] = {
+			.position = glm::vec3(r * std::cos(theta), r * std::sin(theta), -0.25f + 0.1f * std::sin(animationFrame / 30.0f + i)),
+			.radius = 0.6f,
+			.color = hue,
+			.intensity = 1.5f
+		};
+	}
+
+	redraw.setContinuous(RedrawTracker::ANIMATION, animateCamera);
+}
+void Application::render(const RenderPacket &packet) {
+	Frame &f = getCurrentFrame();
+
+	device.waitForFences(1, &f.renderFence, true, UINT64_MAX);
+
+	applyShaderReload();
+
+	// with this frame's fence signaled every frame up to `frame - frameOverlap` is done, so are their old mesh ranges
+	if(frame >= frameOverlap)
+		defragmenter.release(frame - frameOverlap);
+	if(defragmenter.wantsStep(frame) && defragmenter.step(frame))
+		resourceVersion++; // mesh offsets changed, the frames in flight keep drawing from the old ranges
+	if(renderedVisibilityVersion != packet.visibilityVersion) {
+		renderedVisibilityVersion = packet.visibilityVersion;
+		resourceVersion++; // different draws are skipped as occluded
+	}
+
+	device.resetFences(1, &f.renderFence);
+
+	memoryBudget.update(frame);
+
+	uint32_t swapchainImageIndex = device.acquireNextImageKHR(swapchain, 1000000000, f.presentSemaphore, nullptr);
 
-	f.mainCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
-	f.mainCommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &f.globalDescriptorSet, 0, nullptr);
+	// cascades only move once the camera got far enough from where their cache was drawn
+	CameraData camera = packet.cameraData;
+	uint32_t shadowRefresh = shadows.update(camera.sunDirection, camera.view, viewCount, camera.inverseProjection, camera.zNear, shadowDistance, shadowSceneVersion != packet.sceneVersion);
+	shadowSceneVersion = packet.sceneVersion;
+	for(uint32_t c = 0; c < cascades::COUNT; c++) {
+		camera.cascadeViewProjection[c] = shadows.cached[c].viewProjection;
+		camera.cascadeSplits[c] = shadows.splits[c + 1];
+	}
+	memcpy(uniformData + padUniformBufferSize(sizeof(CameraData)) * f.index, &camera, sizeof(CameraData));
+
+	bool occlusionInit = occlusionMode == HIZ_OCCLUSION && !occlusion.initialized;
+	bool setup = shadowRefresh || occlusionInit;
+	if(setup) {
+		f.setupCommandBuffer.reset(vk::CommandBufferResetFlags());
+		f.setupCommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr));
+		if(occlusionInit)
+			occlusion.recordInit(f.setupCommandBuffer);
+		if(shadowRefresh) {
+			meshRegistry.bind(f.setupCommandBuffer);
+			shadows.recordCache(f.setupCommandBuffer, shadowRefresh, [&](uint32_t c) {
+				drawShadowCasters(f.setupCommandBuffer, packet, c, false);
+			});
+			resourceVersion++; // the dynamic casters are culled against the cascades and drawn with their matrices
+		}
+		f.setupCommandBuffer.end();
+	}
+
+	// the fence says the culling this frame ran last time is done, check it before its lights are overwritten
+	if(validateClusters && frame % 60 < frameOverlap)
+		lightCulling.validate(f.index, APPLICATION);
+	std::vector<clusters::View> views(viewCount);
+	for(uint32_t v = 0; v < viewCount; v++)
+		views[v] = {packet.cameraData.view[v], packet.cameraData.inverseProjection, packet.cameraData.zNear, packet.cameraData.zFar};
+	lightCulling.upload(f.index, packet.lights, views);
+
+	// every frame, defragmentation moves the meshes around without changing the scene
+	if(occlusionMode == HIZ_OCCLUSION) {
+		std::vector<OcclusionCulling::Object> objects;
+		objects.reserve(packet.draws.size());
+		for(const Draw &d : packet.draws) {
+			const MeshRegistry::Mesh &m = meshRegistry.get(d.mesh);
+			objects.push_back({glm::vec4(d.boundsMin, 0.0f), glm::vec4(d.boundsMax, 0.0f), m.indexCount, m.firstIndex, m.vertexOffset, 0});
+		}
+		occlusion.upload(f.index, objects);
+	}
 
-	f.mainCommandBuffer.bindVertexBuffers(0, {vertexBuffer.first}, {0});
+	vk::CommandBuffer commandBuffer;
+	if(reuseCommandBuffers) {
+		commandBuffer = f.staticCommandBuffers[swapchainImageIndex];
 
-	PushConstants p;
+		if(f.staticSceneVersions[swapchainImageIndex] != packet.sceneVersion || f.staticResourceVersions[swapchainImageIndex] != resourceVersion) {
+			commandBuffer.reset(vk::CommandBufferResetFlags());
+			commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlags(), nullptr));
+			recordCommands(commandBuffer, swapchainImageIndex, f, packet);
+			commandBuffer.end();
 
-	p = {glm::mat4(1)};
-	f.mainCommandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(PushConstants), &p);
-	f.mainCommandBuffer.draw(triangleVertices.size(), 1, 0, 0);
+			f.staticSceneVersions[swapchainImageIndex] = packet.sceneVersion;
+			f.staticResourceVersions[swapchainImageIndex] = resourceVersion;
+		}
+	} else {
+		commandBuffer = f.mainCommandBuffer;
 
-	f.mainCommandBuffer.endRenderPass();
-	f.mainCommandBuffer.end();
+		commandBuffer.reset(vk::CommandBufferResetFlags());
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr));
+		recordCommands(commandBuffer, swapchainImageIndex, f, packet);
+		commandBuffer.end();
+	}
 
+	// several views only write the swapchain image when copying them over
 	vk::PipelineStageFlags waitDstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-	graphicsQueue.submit(vk::SubmitInfo(1, &f.presentSemaphore, &waitDstStageMask, 1, &f.mainCommandBuffer, 1, &f.renderSemaphore), f.renderFence);
+	if(viewCount > 1)
+		waitDstStageMask |= vk::PipelineStageFlagBits::eTransfer;
+	std::array<vk::CommandBuffer, 2> commandBuffers = {f.setupCommandBuffer, commandBuffer};
+	uint32_t skipped = setup ? 0 : 1;
+	graphicsQueue.submit(vk::SubmitInfo(1, &f.presentSemaphore, &waitDstStageMask, commandBuffers.size() - skipped, commandBuffers.data() + skipped, 1, &f.renderSemaphore), f.renderFence);
 
 	graphicsQueue.presentKHR(vk::PresentInfoKHR(1, &f.renderSemaphore, 1, &swapchain, &swapchainImageIndex));
 
 	frame++;
 }
+void Application::recordCommands(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, const Frame &f, const RenderPacket &packet) {
+	// the G-buffer ones are only used with deferred shading, forward clears color and its own depth buffer
+	std::array<vk::ClearValue, 1 + GBuffer::ATTACHMENT_COUNT> clearValues = {
+		vk::ClearColorValue(std::array<float, 4>{1.0f, 0.3f, 1.0f, 1.0f}),
+		vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f}),
+		vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f}),
+		vk::ClearDepthStencilValue(1.0f, 0)
+	};
+	std::array<vk::ClearValue, 2> forwardClearValues = {clearValues[0], clearValues[1 + GBuffer::DEPTH]};
+	uint32_t clearCount = shading == DEFERRED ? clearValues.size() : forwardClearValues.size();
+	const vk::ClearValue *passClearValues = shading == DEFERRED ? clearValues.data() : forwardClearValues.data();
+
+	// the first `culled` draws go through the occlusion culling, anything past `MAX_OBJECTS` is always drawn
+	bool hiz = occlusionMode == HIZ_OCCLUSION;
+	uint32_t culled = hiz ? std::min<size_t>(packet.draws.size(), OcclusionCulling::MAX_OBJECTS) : 0;
+
+	meshRegistry.bind(commandBuffer);
+
+	// have to happen outside the pass, both end with a barrier for the fragment shaders reading their results
+	lightCulling.record(commandBuffer, f.globalDescriptorSet);
+	shadows.recordComposite(commandBuffer, [&](uint32_t c) {
+		drawShadowCasters(commandBuffer, packet, c, true);
+	});
+	if(hiz)
+		occlusion.recordCull(commandBuffer, f.index, f.globalDescriptorSet, 0, culled);
+
+	if(renderPath == DYNAMIC_RENDERING)
+		beginDynamicRendering(commandBuffer, swapchainImageIndex, clearValues[0], false);
+	else
+		commandBuffer.beginRenderPass(vk::RenderPassBeginInfo(
+			renderPass, swapchainFramebuffers[swapchainImageIndex], vk::Rect2D(vk::Offset2D(), renderExtent),
+			clearCount, passClearValues), vk::SubpassContents::eInline
+		);
+
+	// phase 1 only draws what phase 0 culled, whatever isn't culled at all is drawn along with phase 0
+	auto drawScene = [&](uint32_t phase) {
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &f.globalDescriptorSet, 0, nullptr);
+
+		vk::Pipeline bound;
+		for(uint32_t i = 0; i < packet.draws.size() && (phase == 0 || i < culled); i++) {
+			const Draw &d = packet.draws[i];
+			if(d.occluded)
+				continue;
+			vk::Pipeline p = pipelines.get(d.features);
+			if(p != bound) {
+				commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, p);
+				bound = p;
+			}
+			if(pushConstantStages)
+				commandBuffer.pushConstants(pipelineLayout, pushConstantStages, 0, sizeof(PushConstants), &d.constants);
+			if(i < culled)
+				meshRegistry.drawIndirect(commandBuffer, d.mesh, occlusion.commandBuffer, occlusion.commandOffset(f.index, phase, i));
+			else
+				meshRegistry.draw(commandBuffer, d.mesh);
+		}
+	};
+	drawScene(0);
+
+	if(hiz) {
+		if(renderPath == DYNAMIC_RENDERING)
+			endDynamicRendering(commandBuffer, swapchainImageIndex, true);
+		else
+			commandBuffer.endRenderPass();
+
+		occlusion.recordPyramid(commandBuffer);
+		occlusion.recordCull(commandBuffer, f.index, f.globalDescriptorSet, 1, culled);
+
+		if(renderPath == DYNAMIC_RENDERING)
+			beginDynamicRendering(commandBuffer, swapchainImageIndex, clearValues[0], true);
+		else
+			commandBuffer.beginRenderPass(vk::RenderPassBeginInfo(
+				disoccludedRenderPass, swapchainFramebuffers[swapchainImageIndex], vk::Rect2D(vk::Offset2D(), renderExtent),
+				0, nullptr), vk::SubpassContents::eInline
+			);
+		drawScene(1);
+	}
+
+	if(shading == DEFERRED) {
+		commandBuffer.nextSubpass(vk::SubpassContents::eInline);
+
+		// the push constant ranges differ, so set 0 isn't compatible between the layouts and has to be bound again
+		std::array<vk::DescriptorSet, 2> lightingSets = {f.globalDescriptorSet, gbuffer.descriptorSet};
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, lightingPipeline);
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightingPipelineLayout, 0, lightingSets.size(), lightingSets.data(), 0, nullptr);
+		commandBuffer.draw(3, 1, 0, 0);
+	}
+
+	if(renderPath == DYNAMIC_RENDERING)
+		endDynamicRendering(commandBuffer, swapchainImageIndex, false);
+	else
+		commandBuffer.endRenderPass();
+
+	if(viewCount > 1)
+		multiview.present(commandBuffer, swapchainImages[swapchainImageIndex], swapchainExtent, clearValues[0].color);
+}
+void Application::drawShadowCasters(vk::CommandBuffer commandBuffer, const RenderPacket &packet, uint32_t cascade, bool dynamic) {
+	const cascades::Cascade &c = shadows.cached[cascade];
+	for(const Draw &d : packet.draws) {
+		if(d.dynamic != dynamic || !cascades::overlaps(c, shadows.lightView, d.boundsMin, d.boundsMax))
+			continue;
+		PushConstants constants = {c.viewProjection * d.constants.transformMatrix};
+		commandBuffer.pushConstants(shadowPipelineLayout, shadowInterface.pushConstantStages(0, sizeof(PushConstants)), 0, sizeof(PushConstants), &constants);
+		meshRegistry.draw(commandBuffer, d.mesh);
+	}
+}
+void Application::beginDynamicRendering(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, const vk::ClearValue &clearValue, bool resume) {
+	bool multiviewPass = viewCount > 1;
+	vk::ImageSubresourceRange colorRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, viewCount);
+	vk::ImageSubresourceRange depthRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, viewCount);
+	std::array<vk::ImageMemoryBarrier2KHR, 2> barriers;
+
+	if(resume) {
+		// the second half keeps drawing over the first one's color, and into the depth the pyramid was built from
+		barriers[0] = vk::ImageMemoryBarrier2KHR(
+			vk::PipelineStageFlagBits2KHR::eColorAttachmentOutput, vk::AccessFlagBits2KHR::eColorAttachmentWrite,
+			vk::PipelineStageFlagBits2KHR::eColorAttachmentOutput, vk::AccessFlagBits2KHR::eColorAttachmentRead | vk::AccessFlagBits2KHR::eColorAttachmentWrite,
+			vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eColorAttachmentOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			multiviewPass ? multiview.image : swapchainImages[swapchainImageIndex], colorRange
+		);
+		barriers[1] = vk::ImageMemoryBarrier2KHR(
+			vk::PipelineStageFlagBits2KHR::eComputeShader, vk::AccessFlagBits2KHR::eNone,
+			vk::PipelineStageFlagBits2KHR::eEarlyFragmentTests | vk::PipelineStageFlagBits2KHR::eLateFragmentTests, vk::AccessFlagBits2KHR::eDepthStencilAttachmentRead | vk::AccessFlagBits2KHR::eDepthStencilAttachmentWrite,
+			vk::ImageLayout::eDepthStencilReadOnlyOptimal, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			depthImage.first, depthRange
+		);
+	} else {
+		// what the render pass' external dependency and initial layout did. the source stage matches the stage
+		// the acquire semaphore is waited on, so the transition can't happen before the image is actually ours.
+		// the multiview image is shared between frames, the previous frame's copy out of it has to be done
+		barriers[0] = vk::ImageMemoryBarrier2KHR(
+			multiviewPass ? vk::PipelineStageFlagBits2KHR::eColorAttachmentOutput | vk::PipelineStageFlagBits2KHR::eTransfer : vk::PipelineStageFlagBits2KHR::eColorAttachmentOutput,
+			multiviewPass ? vk::AccessFlagBits2KHR::eColorAttachmentWrite : vk::AccessFlagBits2KHR::eNone,
+			vk::PipelineStageFlagBits2KHR::eColorAttachmentOutput, vk::AccessFlagBits2KHR::eColorAttachmentWrite,
+			vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			multiviewPass ? multiview.image : swapchainImages[swapchainImageIndex], colorRange
+		);
+		// so is the depth buffer, the previous frame's tests and pyramid build have to be done with it and its writes available
+		barriers[1] = vk::ImageMemoryBarrier2KHR(
+			vk::PipelineStageFlagBits2KHR::eLateFragmentTests | vk::PipelineStageFlagBits2KHR::eComputeShader, vk::AccessFlagBits2KHR::eDepthStencilAttachmentWrite,
+			vk::PipelineStageFlagBits2KHR::eEarlyFragmentTests | vk::PipelineStageFlagBits2KHR::eLateFragmentTests, vk::AccessFlagBits2KHR::eDepthStencilAttachmentRead | vk::AccessFlagBits2KHR::eDepthStencilAttachmentWrite,
+			vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			depthImage.first, depthRange
+		);
+	}
+	commandBuffer.pipelineBarrier2KHR(vk::DependencyInfoKHR(vk::DependencyFlags(), 0, nullptr, 0, nullptr, barriers.size(), barriers.data()));
+
+	vk::RenderingAttachmentInfoKHR colorAttachment(
+		multiviewPass ? multiview.view : swapchainImageViews[swapchainImageIndex], vk::ImageLayout::eColorAttachmentOptimal,
+		vk::ResolveModeFlagBits::eNone, nullptr, vk::ImageLayout::eUndefined,
+		resume ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+		clearValue
+	);
+	// only kept when there's a second half, for the pyramid
+	vk::RenderingAttachmentInfoKHR depthAttachment(
+		depthImageView, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+		vk::ResolveModeFlagBits::eNone, nullptr, vk::ImageLayout::eUndefined,
+		resume ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear,
+		occlusionMode == HIZ_OCCLUSION && !resume ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
+		vk::ClearDepthStencilValue(1.0f, 0)
+	);
+	commandBuffer.beginRenderingKHR(vk::RenderingInfoKHR(vk::RenderingFlagsKHR(),
+		vk::Rect2D(vk::Offset2D(), renderExtent), 1, multiviewPass ? multiview.viewMask() : 0,
+		1, &colorAttachment,
+		&depthAttachment, nullptr
+	));
+}
+void Application::endDynamicRendering(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, bool suspend) {
+	commandBuffer.endRenderingKHR();
+
+	if(suspend) {
+		// the pyramid build reads the depth next, the color attachment stays as it is for `beginDynamicRendering(resume)`
+		vk::ImageMemoryBarrier2KHR toShaderRead(
+			vk::PipelineStageFlagBits2KHR::eLateFragmentTests, vk::AccessFlagBits2KHR::eDepthStencilAttachmentWrite,
+			vk::PipelineStageFlagBits2KHR::eComputeShader, vk::AccessFlagBits2KHR::eShaderRead,
+			vk::ImageLayout::eDepthStencilAttachmentOptimal, vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			depthImage.first,
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, viewCount)
+		);
+		commandBuffer.pipelineBarrier2KHR(vk::DependencyInfoKHR(vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toShaderRead));
+		return;
+	}
+
+	if(viewCount > 1) {
+		// `multiview.present` copies the views out next
+		vk::ImageMemoryBarrier2KHR toTransfer(
+			vk::PipelineStageFlagBits2KHR::eColorAttachmentOutput, vk::AccessFlagBits2KHR::eColorAttachmentWrite,
+			vk::PipelineStageFlagBits2KHR::eTransfer, vk::AccessFlagBits2KHR::eTransferRead,
+			vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eTransferSrcOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			multiview.image,
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, viewCount)
+		);
+		commandBuffer.pipelineBarrier2KHR(vk::DependencyInfoKHR(vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toTransfer));
+		return;
+	}
+
+	// presentation engine reads are made visible by the render semaphore, nothing to wait for here
+	vk::ImageMemoryBarrier2KHR toPresent(
+		vk::PipelineStageFlagBits2KHR::eColorAttachmentOutput, vk::AccessFlagBits2KHR::eColorAttachmentWrite,
+		vk::PipelineStageFlagBits2KHR::eNone, vk::AccessFlagBits2KHR::eNone,
+		vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::ePresentSrcKHR,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		swapchainImages[swapchainImageIndex],
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+	);
+	commandBuffer.pipelineBarrier2KHR(vk::DependencyInfoKHR(vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toPresent));
+}
+void Application::renderLoop() {
+	RenderPacket packet;
+	while(renderPackets.pop(packet))
+		render(packet);
+}
+void Application::startRenderThread() {
+	renderThread = std::thread(&Application::renderLoop, this);
+}
 void Application::loop() {
-	input();
-	render();
+	// GLFW events have to be handled on the main thread
+	if(redrawMode == ON_DEMAND && !redraw.pending())
+		glfwWaitEvents(); // sleeps until input, a window event or `redraw.request` from any thread
+	else
+		glfwPollEvents();
+
+	uint32_t reasons = redraw.consume();
+	if(reasons == 0 && redrawMode == ON_DEMAND)
+		return;
+
+	RenderPacket packet;
+	input(packet);
+	simulationFrame++;
+	// input or window events alone mustn't move anything, or every redraw they cause would look like animation
+	if(reasons & RedrawTracker::ANIMATION)
+		animationFrame++;
+
+	// blocks only once the render thread is a whole queue behind
+	renderPackets.push(std::move(packet));
 };
+void Application::stopRenderThread() {
+	renderPackets.close();
+	renderThread.join();
+}
 void Application::cleanup() {
 	device.waitIdle();
 	deletionQueue.clear();
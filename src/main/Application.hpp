@@ -7,15 +7,55 @@
 
 #include <util/Window.hpp>
 #include <util/DeletionQueue.hpp>
+#include <util/BoundedQueue.hpp>
+#include <util/RedrawTracker.hpp>
+#include <util/Config.hpp>
+#include <util/TaskGraph.hpp>
+#include <render/MeshRegistry.hpp>
+#include <render/MemoryBudget.hpp>
+#include <render/Defragmenter.hpp>
+#include <render/Validation.hpp>
+#include <render/ShaderReflection.hpp>
+#include <render/LayoutCache.hpp>
+#include <render/PipelineVariants.hpp>
+#include <render/ShaderHotReload.hpp>
+#include <render/MultiviewTarget.hpp>
+#include <render/GBuffer.hpp>
+#include <render/LightCulling.hpp>
+#include <render/ShadowCascades.hpp>
+#include <render/OcclusionCulling.hpp>
+#include <render/SoftwareOcclusion.hpp>
+#include <asset/AssetPack.hpp>
+#include <asset/AssetLoader.hpp>
 
 #include <cstdio>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <fstream>
+#include <thread>
 
 class Application {
 public:
+	enum RedrawMode : uint8_t {
+		CONTINUOUS, // render every vblank
+		ON_DEMAND // sleep in `glfwWaitEvents` until some subsystem asks for a redraw
+	};
+	enum RenderPath : uint8_t {
+		RENDER_PASS, // `renderPass` and one framebuffer per swapchain image
+		DYNAMIC_RENDERING // `VK_KHR_dynamic_rendering`, layout transitions are explicit sync2 barriers
+	};
+	enum ShadingPath : uint8_t {
+		FORWARD, // every draw is lit in its own fragment shader
+		DEFERRED // draws fill `gbuffer`, a second subpass lights every pixel once from input attachments
+	};
+	enum OcclusionMode : uint8_t {
+		NO_OCCLUSION,
+		HIZ_OCCLUSION, // `occlusion` culls the draws on the GPU against last frame's depth, forward shading only
+		CPU_OCCLUSION // `softwareOcclusion` culls them on the main thread against a few occluders
+	};
+
 	typedef std::pair<vk::Buffer, vma::Allocation> AllocatedBuffer;
-	typedef std::pair<vk::Buffer, vma::Allocation> AllocatedImage;
+	typedef std::pair<vk::Image, vma::Allocation> AllocatedImage;
 
 	struct Frame {
 		uint8_t index;
@@ -23,6 +63,15 @@ public:
 		vk::CommandPool commandPool;
 		vk::CommandBuffer mainCommandBuffer;
 
+		// recorded once per swapchain image and resubmitted for as long as the scene doesn't change
+		std::vector<vk::CommandBuffer> staticCommandBuffers;
+		std::vector<uint64_t> staticSceneVersions; // `UINT64_MAX` if never recorded
+		std::vector<uint64_t> staticResourceVersions;
+
+		// one-off work ahead of the frame: static shadow cache redraws, first use initialisation. only submitted
+		// when there is some
+		vk::CommandBuffer setupCommandBuffer;
+
 		vk::Semaphore presentSemaphore, renderSemaphore;
 		vk::Fence renderFence;
 
@@ -41,11 +90,47 @@ public:
 		glm::vec3 color;
 	};
 	struct CameraData {
+		static constexpr uint32_t MAX_VIEWS = 4; // `MAX_VIEWS` in camera.glsl
+
 		alignas(16) glm::vec3 cameraPosition;
+		alignas(16) glm::mat4 viewProjection[MAX_VIEWS]; // indexed with `gl_ViewIndex`, only the first `viewCount` are used
+		alignas(16) glm::mat4 view[MAX_VIEWS];
+		alignas(16) glm::mat4 inverseView[MAX_VIEWS];
+		alignas(16) glm::mat4 projection; // shared by all views
+		alignas(16) glm::mat4 inverseProjection;
+		alignas(8) glm::vec2 viewportSize; // of one view, in pixels
+		float zNear, zFar;
+		alignas(16) glm::mat4 cascadeViewProjection[cascades::COUNT]; // filled in by the render thread
+		alignas(16) glm::vec4 cascadeSplits; // view space depth where each cascade ends
+		alignas(16) glm::vec3 sunDirection; // where the light travels
+		alignas(16) glm::vec3 sunColor;
 	};
 	struct PushConstants {
 		alignas(16) glm::mat4 transformMatrix;
 	};
+	/// shaders rebuilt by hot reload, waiting to be swapped in or for the frames still using them to finish
+	struct ShaderReload {
+		vk::ShaderModule vertShaderModule, fragShaderModule;
+		std::unique_ptr<PipelineVariants> pipelines;
+		uint64_t retiredFrame;
+	};
+	struct Draw {
+		MeshRegistry::MeshHandle mesh;
+		ShaderFeatures features = FEATURE_NONE; // picks the pipeline variant
+		PushConstants constants;
+		bool dynamic = false; // moves, so it's drawn into the shadow cascades every frame instead of into their cache
+		glm::vec3 boundsMin, boundsMax; // world space
+		bool occluded = false; // hidden behind `softwareOcclusion`'s occluders, still drawn into the shadows
+	};
+	/// everything the render thread needs to draw one frame, never modified once it's queued
+	struct RenderPacket {
+		uint64_t frame; // simulation frame this was produced on
+		uint64_t sceneVersion; // changes whenever `draws` differ from the previous packet's
+		uint64_t visibilityVersion; // changes when only `Draw::occluded` does, leaves the shadow cache alone
+		CameraData cameraData;
+		std::vector<Draw> draws;
+		std::vector<clusters::PointLight> lights;
+	};
 protected:
 	const static litelogger::Logger VALIDATION;
 	const static litelogger::Logger APPLICATION;
@@ -53,93 +138,199 @@ public:
 	vk::Instance instance;
 	std::vector<const char *> instanceExtensions;
 	std::vector<const char *> validationLayers;
+	Validation validation;
 
 	Window window;
 
 	vk::PhysicalDevice physicalDevice;
+	// queried once when picking the device
+	vk::PhysicalDeviceProperties physicalDeviceProperties;
+	vk::PhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
 	vk::Device device;
 	std::vector<const char *> deviceExtensions;
 
 	vk::Queue graphicsQueue;
 	uint32_t graphicsQueueFamily;
+	vk::Queue transferQueue; // second queue of the graphics family if there is one, otherwise `graphicsQueue`
+	uint32_t transferQueueFamily;
+	std::mutex transferQueueMutex; // the asset loader and the defragmenter both submit to `transferQueue`
 
 	vma::Allocator allocator;
+	MemoryBudget memoryBudget;
+	bool memoryBudgetSupported;
+	Defragmenter defragmenter;
 
 	vk::SwapchainKHR swapchain;
 	vk::Format swapchainImageFormat;
 	vk::Extent2D swapchainExtent;
+	vk::Extent2D renderExtent; // what the pass renders at, `swapchainExtent` unless there are several views
 	std::vector<vk::Image> swapchainImages;
 	std::vector<vk::ImageView> swapchainImageViews;
-	std::vector<vk::Framebuffer> swapchainFramebuffers;
+	std::vector<vk::Framebuffer> swapchainFramebuffers; // empty with `DYNAMIC_RENDERING`
 
+	// forward shading only, the G-buffer has its own. shared between frames in flight like the G-buffer
+	vk::Format depthFormat;
 	AllocatedImage depthImage;
 	vk::ImageView depthImageView;
 
 	vk::DescriptorPool descriptorPool;
 	vk::DescriptorSetLayout globalSetLayout;
 	AllocatedBuffer uniformBuffer;
+	uint8_t *uniformData; // persistently mapped, only dynamic data lives here
+
+	RenderPath renderPath; // `VKENGINE_RENDER_PATH=dynamic`, falls back to `RENDER_PASS` if the device can't
+	vk::RenderPass renderPass; // null with `DYNAMIC_RENDERING`
+	vk::RenderPass disoccludedRenderPass; // loads what `renderPass` drew, for the draws only the second culling phase lets through
+
+	// `VKENGINE_VIEWS=n` renders n views in one multiview pass into `multiview`, which is then blitted to the swapchain
+	uint32_t viewCount;
+	MultiviewTarget multiview; // unused with a single view, that one renders straight into the swapchain image
+
+	// `VKENGINE_SHADING=deferred`, needs subpasses so it always uses `RENDER_PASS`
+	ShadingPath shading;
+	GBuffer gbuffer;
+	AssetPack::Span lightingVertShaderCode, lightingFragShaderCode;
+	ShaderReflection lightingInterface;
+	vk::ShaderModule lightingVertShaderModule, lightingFragShaderModule;
+	vk::DescriptorSetLayout gbufferSetLayout;
+	vk::PipelineLayout lightingPipelineLayout;
+	vk::Pipeline lightingPipeline;
 
-	vk::RenderPass renderPass;
+	// clustered lighting, used by both shading paths. `VKENGINE_LIGHTS` demo lights, `VKENGINE_VALIDATE_CLUSTERS=1`
+	// reads the culled grid back every now and then and compares it against the CPU reference
+	LightCulling lightCulling;
+	AssetPack::Span cullShaderCode;
+	vk::ShaderModule cullShaderModule;
+	uint32_t lightCount;
+	bool validateClusters;
+
+	// sun shadows, `VKENGINE_SHADOW_RESOLUTION` per cascade. static casters are cached until a cascade moves,
+	// which is assumed to only change along with `sceneVersion`
+	ShadowCascades shadows;
+	AssetPack::Span shadowShaderCode;
+	ShaderReflection shadowInterface;
+	vk::ShaderModule shadowShaderModule;
+	vk::PipelineLayout shadowPipelineLayout;
+	float shadowDistance; // view space depth the last cascade ends at
+	uint64_t shadowSceneVersion; // `sceneVersion` the cache was drawn with
+
+	// `VKENGINE_OCCLUSION=hiz`, draws become indirect and are culled twice per frame, see `OcclusionCulling`
+	OcclusionMode occlusionMode;
+	OcclusionCulling occlusion;
+	AssetPack::Span hizShaderCode, occlusionShaderCode;
+	ShaderReflection hizInterface, occlusionInterface;
+	vk::ShaderModule hizShaderModule, occlusionShaderModule;
+	// `VKENGINE_OCCLUSION=cpu` instead, rasterized on `VKENGINE_OCCLUSION_THREADS` threads. main thread only
+	SoftwareOcclusion softwareOcclusion;
+	SoftwareOcclusion::MeshHandle triangleOccluder;
+	std::vector<bool> softwareOccluded; // the previous packet's, draws turning visible or hidden change the scene
 
 	std::vector<Frame> frames;
 
+	LayoutCache layoutCache; // owns every descriptor set and pipeline layout
 	vk::PipelineLayout pipelineLayout;
-	vk::Pipeline pipeline;
+	vk::ShaderStageFlags pushConstantStages;
+	PipelineVariants pipelines; // one per `ShaderFeatures` combination the draws use
+	vk::PipelineCache pipelineCache;
+	vk::ShaderModule vertShaderModule, fragShaderModule;
 
-	AllocatedBuffer vertexBuffer;
+	// `VKENGINE_SHADER_RELOAD=1` (or a directory) recompiles shaders when their sources change
+	ShaderHotReload shaderHotReload;
+	std::vector<uint32_t> vertShaderSource, fragShaderSource; // latest SPIR-V, only touched by the watcher thread
+	std::mutex shaderReloadMutex;
+	std::unique_ptr<ShaderReload> pendingShaderReload;
+	std::vector<std::unique_ptr<ShaderReload>> retiredShaderReloads; // render thread only
+	AssetPack::Span vertShaderCode, fragShaderCode; // views into `assets`
+	const char *fragShaderName; // `gbuffer.frag` replaces `triangle.frag` with deferred shading
+	ShaderReflection shaderInterface; // both stages merged, layouts are derived from this
+	ShaderReflection globalInterface; // every pipeline using set 0 merged, the global set layout comes from this
+
+	MeshRegistry meshRegistry; // every mesh's vertices and indices live in here
+	MeshRegistry::MeshHandle triangleMesh;
+	static constexpr ShaderFeatures TRIANGLE_FEATURES = FEATURE_VERTEX_COLOR; // every draw's variant, prebuilt at startup
+	Defragmenter::ArenaHandle vertexArenaHandle, indexArenaHandle;
 	std::vector<Vertex> triangleVertices;
+	std::vector<uint16_t> triangleIndices;
+	glm::vec3 triangleBoundsMin, triangleBoundsMax;
 
 	glm::vec3 cameraPosition;
 
+	AssetPack assets; // `VKENGINE_ASSETS`, defaults to the `assets.pack` built next to the executable
+	AssetLoader loader; // coroutine based streaming, `VKENGINE_WORKERS` worker threads
+
 	DeletionQueue deletionQueue;
 	uint64_t frame; // how many frames have been rendered so far
+	uint64_t simulationFrame; // how many render packets have been produced so far
+	uint64_t animationFrame; // clock for the camera and lights, stands still unless `RedrawTracker::ANIMATION` is continuous
+	uint64_t sceneVersion; // bump whenever the draw list changes, invalidates pre-recorded command buffers
+	uint64_t resourceVersion; // same, but for render side changes like buffers being moved
+	uint64_t visibilityVersion; // bump when the CPU occlusion results change, the render thread turns it into `resourceVersion`
+	uint64_t renderedVisibilityVersion; // `visibilityVersion` of the last rendered packet
+	bool reuseCommandBuffers; // re-record command buffers only when a version changes
+
+	RedrawMode redrawMode; // `VKENGINE_REDRAW=ondemand` to only render when something changed
+	RedrawTracker redraw;
+	bool animateCamera;
 	uint8_t frameOverlap;
+
+	// simulation (main thread) runs at most this many packets ahead of the render thread
+	BoundedQueue<RenderPacket> renderPackets{2};
+	std::thread renderThread;
 public:
 	void init();
+	void startRenderThread();
 	void loop();
+	void stopRenderThread();
 	void cleanup();
 protected:
-	void input();
-	void render();
+	void input(RenderPacket &packet);
+	void render(const RenderPacket &packet);
+	void recordCommands(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, const Frame &f, const RenderPacket &packet);
+	/// the static or dynamic casters overlapping `cascade`, with the shadow pipeline bound
+	void drawShadowCasters(vk::CommandBuffer commandBuffer, const RenderPacket &packet, uint32_t cascade, bool dynamic);
+	/// `resume` continues after `endDynamicRendering(suspend)`, loading what was drawn so far
+	void beginDynamicRendering(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, const vk::ClearValue &clearValue, bool resume);
+	/// `suspend` leaves the depth buffer readable by compute shaders and the color attachment as it is
+	void endDynamicRendering(vk::CommandBuffer commandBuffer, uint32_t swapchainImageIndex, bool suspend);
+	void renderLoop();
+
+	Task<MeshRegistry::MeshHandle> loadTriangle();
 
 	void initInstance();
 	void initWindow();
+	void initSurface();
 	void initPhysicalDevice();
 	void initLogicalDevice();
 	void initMemoryAllocator();
 	void initSwapchain();
 	void initRenderPass();
+	void initDeferredRenderPass();
 	void initFramebuffers();
 	void initFrames();
 	void initVertexArray();
 	void initDescriptors();
+	void initAssets();
+	void initAssetLoader();
 	void initGraphicsPipeline(); // TODO store in `Renderer` class for more dynamic rendering shtuff
+	void initLightingPass();
+	void initLightCulling();
+	void initShadows();
+	void initOcclusionCulling();
+	vk::Pipeline buildPipeline(vk::ShaderModule vert, vk::ShaderModule frag, const vk::SpecializationInfo &specialization);
+	void startShaderHotReload(const char *directory);
+	void reloadShader(const std::string &name, std::vector<uint32_t> &&code);
+	void applyShaderReload();
+	void destroyShaderReload(ShaderReload &reload);
 
 	Frame &getCurrentFrame() {
 		return frames[frame % frameOverlap];
 	}
 	size_t padUniformBufferSize(size_t originalSize) {
-		size_t minAlignment = physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+		size_t minAlignment = physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
 		if(minAlignment > 0)
 			return (originalSize + minAlignment - 1) & ~(minAlignment - 1);
 		return originalSize;
 	}
-	std::vector<char> readFile(const char *filename) {
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-		if(!file.is_open())
-			litelogger::exitError("Failed to open file :(");
-
-		size_t fileSize = (size_t) file.tellg();
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-
-		file.close();
-
-		return buffer;
-	}
 };
 
 #endif //APPLICATION_HPP
\ No newline at end of file
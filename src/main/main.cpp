@@ -1,23 +1,30 @@
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.hpp>
-#include <litelogger.hpp>
+#include <util/AsyncLog.hpp>
 
 #include <main/Application.hpp>
 
 #include <cstdlib>
 
+VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
+
 int main() {
 	litelogger::changeLevel(-1);
+	asynclog::start();
 
 	glfwInit();
 
 	Application application;
 	application.init();
+	application.startRenderThread();
 	while(!application.window.shouldClose())
 		application.loop();
+	application.stopRenderThread();
 	application.cleanup();
 
 	glfwTerminate();
 
+	asynclog::stop();
+
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "Cascades.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cascades {
+	glm::mat4 lightView(glm::vec3 direction) {
+		glm::vec3 z = glm::normalize(direction);
+		glm::vec3 up = std::abs(z.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 x = glm::normalize(glm::cross(z, up));
+		glm::vec3 y = glm::cross(z, x);
+
+		// rows are the light space axes
+		glm::mat4 view(1.0f);
+		for(uint32_t i = 0; i < 3; i++) {
+			view[i][0] = x[i];
+			view[i][1] = y[i];
+			view[i][2] = z[i];
+		}
+		return view;
+	}
+
+	void splits(float zNear, float distance, float splits[COUNT + 1]) {
+		splits[0] = zNear;
+		for(uint32_t i = 1; i <= COUNT; i++) {
+			float p = static_cast<float>(i) / static_cast<float>(COUNT);
+			float logarithmic = zNear * std::pow(distance / zNear, p);
+			float uniform = zNear + (distance - zNear) * p;
+			splits[i] = SPLIT_LAMBDA * logarithmic + (1.0f - SPLIT_LAMBDA) * uniform;
+		}
+	}
+
+	/// direction from the eye through `ndc`, scaled to z = 1
+	static glm::vec3 ray(const glm::mat4 &inverseProjection, glm::vec2 ndc) {
+		glm::vec4 p = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+		return glm::vec3(p) / p.z;
+	}
+
+	Cascade fit(const glm::mat4 &lightView, const glm::mat4 *views, uint32_t viewCount, const glm::mat4 &inverseProjection, float zNear, float zFar, uint32_t resolution) {
+		glm::vec3 rays[4] = {
+			ray(inverseProjection, glm::vec2(-1.0f, -1.0f)),
+			ray(inverseProjection, glm::vec2( 1.0f, -1.0f)),
+			ray(inverseProjection, glm::vec2(-1.0f,  1.0f)),
+			ray(inverseProjection, glm::vec2( 1.0f,  1.0f))
+		};
+
+		// the sphere's center and radius move rigidly with the camera, the radius only changes with the projection
+		glm::vec3 corners[8 * 4];
+		uint32_t cornerCount = 0;
+		glm::vec3 center(0.0f);
+		for(uint32_t v = 0; v < viewCount && v < 4; v++) {
+			glm::mat4 inverseView = glm::inverse(views[v]);
+			for(const glm::vec3 &r : rays) {
+				for(float z : {zNear, zFar}) {
+					corners[cornerCount] = glm::vec3(inverseView * glm::vec4(r * z, 1.0f));
+					center += corners[cornerCount++];
+				}
+			}
+		}
+		center /= static_cast<float>(cornerCount);
+		float radius = 0.0f;
+		for(uint32_t i = 0; i < cornerCount; i++)
+			radius = std::max(radius, glm::length(corners[i] - center));
+		radius = std::ceil(radius * 16.0f) / 16.0f; // float noise from turning shouldn't count as a different size
+
+		// margin for the cached box to lag behind, plus one texel for the snapping
+		Cascade cascade;
+		cascade.halfExtent = radius / (1.0f - 2.0f * (REFRESH_TEXELS + 1.0f) / static_cast<float>(resolution));
+		cascade.texel = 2.0f * cascade.halfExtent / static_cast<float>(resolution);
+
+		glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+		cascade.center = glm::vec3(glm::floor(glm::vec2(lightCenter) / cascade.texel) * cascade.texel, lightCenter.z);
+		cascade.zMin = cascade.center.z - cascade.halfExtent - CASTER_DISTANCE;
+		cascade.zMax = cascade.center.z + cascade.halfExtent;
+
+		glm::mat4 projection(1.0f);
+		projection[0][0] = 1.0f / cascade.halfExtent;
+		projection[1][1] = 1.0f / cascade.halfExtent;
+		projection[2][2] = 1.0f / (cascade.zMax - cascade.zMin);
+		projection[3][0] = -cascade.center.x / cascade.halfExtent;
+		projection[3][1] = -cascade.center.y / cascade.halfExtent;
+		projection[3][2] = -cascade.zMin / (cascade.zMax - cascade.zMin);
+		cascade.viewProjection = projection * lightView;
+		return cascade;
+	}
+
+	bool moved(const Cascade &cached, const Cascade &ideal) {
+		if(cached.halfExtent != ideal.halfExtent)
+			return true;
+		glm::vec3 offset = glm::abs(ideal.center - cached.center);
+		return std::max(std::max(offset.x, offset.y), offset.z) > REFRESH_TEXELS * cached.texel;
+	}
+
+	bool overlaps(const Cascade &cascade, const glm::mat4 &lightView, glm::vec3 min, glm::vec3 max) {
+		glm::vec3 center = glm::vec3(lightView * glm::vec4((min + max) * 0.5f, 1.0f));
+		glm::vec3 half = (max - min) * 0.5f;
+		glm::vec3 extent(0.0f);
+		for(uint32_t axis = 0; axis < 3; axis++)
+			for(uint32_t i = 0; i < 3; i++)
+				extent[axis] += std::abs(lightView[i][axis]) * half[i];
+
+		// nothing behind the box can cast into it, everything in front of it can
+		return std::abs(center.x - cascade.center.x) <= cascade.halfExtent + extent.x
+			&& std::abs(center.y - cascade.center.y) <= cascade.halfExtent + extent.y
+			&& center.z - extent.z <= cascade.zMax
+			&& center.z + extent.z >= cascade.zMin;
+	}
+}
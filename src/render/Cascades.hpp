@@ -0,0 +1,41 @@
+#ifndef CASCADES_HPP
+#define CASCADES_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/// Cascade fitting for directional light shadows. Each cascade covers one depth range of the camera with an
+/// orthographic box around the bounding sphere of that frustum slice. The sphere only depends on the projection,
+/// so the box keeps its size however the camera turns, and its center is snapped to whole texels.
+///
+/// Cascades are cached: a fitted cascade gets `REFRESH_TEXELS` texels of margin on every side and keeps its matrix
+/// until the camera has moved further than that, only then do its static casters have to be drawn again.
+/// Everything is in light space, x and y across the shadow map, z along the light's direction.
+namespace cascades {
+	constexpr uint32_t COUNT = 4; // `MAX_CASCADES` in camera.glsl, laid out 2x2 in the atlas
+	constexpr float REFRESH_TEXELS = 32.0f;
+	constexpr float CASTER_DISTANCE = 20.0f; // how far towards the light casters outside the slice are still caught
+	constexpr float SPLIT_LAMBDA = 0.75f; // blend between logarithmic (1) and uniform (0) splits
+
+	struct Cascade {
+		glm::mat4 viewProjection; // world to the cascade's clip space, depth from 0 to 1
+		glm::vec3 center; // x and y snapped to texels
+		float halfExtent; // of the box in x and y, margin included
+		float texel; // world space size of one shadow map texel
+		float zMin, zMax;
+	};
+
+	/// rotation from world to light space, `direction` is where the light travels
+	glm::mat4 lightView(glm::vec3 direction);
+	/// view space depths where each cascade starts, `splits[COUNT]` is `distance`
+	void splits(float zNear, float distance, float splits[COUNT + 1]);
+	/// cascade for the view space depths `[zNear, zFar]` of every view, `views` are world to view
+	Cascade fit(const glm::mat4 &lightView, const glm::mat4 *views, uint32_t viewCount, const glm::mat4 &inverseProjection, float zNear, float zFar, uint32_t resolution);
+	/// whether `ideal` is no longer covered by the `cached` box
+	bool moved(const Cascade &cached, const Cascade &ideal);
+	/// whether a world space box can cast a shadow into the cascade
+	bool overlaps(const Cascade &cascade, const glm::mat4 &lightView, glm::vec3 min, glm::vec3 max);
+}
+
+#endif //CASCADES_HPP
@@ -0,0 +1,66 @@
+#include "Clusters.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace clusters {
+	float sliceDepth(const View &view, uint32_t slice) {
+		return view.zNear * std::pow(view.zFar / view.zNear, static_cast<float>(slice) / static_cast<float>(Z));
+	}
+	uint32_t slice(const View &view, float z) {
+		float s = std::log(z / view.zNear) / std::log(view.zFar / view.zNear) * static_cast<float>(Z);
+		return static_cast<uint32_t>(std::clamp(s, 0.0f, static_cast<float>(Z - 1)));
+	}
+
+	/// direction from the eye through `ndc`, scaled to z = 1
+	static glm::vec3 ray(const View &view, glm::vec2 ndc) {
+		glm::vec4 p = view.inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+		return glm::vec3(p) / p.z;
+	}
+	void bounds(const View &view, uint32_t x, uint32_t y, uint32_t z, glm::vec3 &min, glm::vec3 &max) {
+		glm::vec2 ndcMin = glm::vec2(x, y) / glm::vec2(X, Y) * 2.0f - 1.0f;
+		glm::vec2 ndcMax = glm::vec2(x + 1, y + 1) / glm::vec2(X, Y) * 2.0f - 1.0f;
+		glm::vec3 rays[4] = {
+			ray(view, ndcMin),
+			ray(view, glm::vec2(ndcMax.x, ndcMin.y)),
+			ray(view, glm::vec2(ndcMin.x, ndcMax.y)),
+			ray(view, ndcMax)
+		};
+		float zNear = sliceDepth(view, z), zFar = sliceDepth(view, z + 1);
+
+		min = glm::vec3(INFINITY);
+		max = glm::vec3(-INFINITY);
+		for(const glm::vec3 &r : rays) {
+			min = glm::min(min, glm::min(r * zNear, r * zFar));
+			max = glm::max(max, glm::max(r * zNear, r * zFar));
+		}
+	}
+
+	void cull(const View &view, const PointLight *lights, uint32_t lightCount, Grid &grid) {
+		lightCount = std::min(lightCount, MAX_LIGHTS);
+
+		// transformed once instead of per cluster, like the shader does per batch in shared memory
+		glm::vec4 viewLights[MAX_LIGHTS];
+		for(uint32_t i = 0; i < lightCount; i++)
+			viewLights[i] = glm::vec4(glm::vec3(view.view * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+
+		for(uint32_t z = 0; z < Z; z++) {
+			for(uint32_t y = 0; y < Y; y++) {
+				for(uint32_t x = 0; x < X; x++) {
+					glm::vec3 min, max;
+					bounds(view, x, y, z, min, max);
+
+					uint32_t c = index(x, y, z);
+					uint32_t count = 0;
+					for(uint32_t i = 0; i < lightCount && count < MAX_LIGHTS_PER_CLUSTER; i++) {
+						glm::vec3 center = glm::vec3(viewLights[i]);
+						glm::vec3 d = glm::clamp(center, min, max) - center;
+						if(glm::dot(d, d) <= viewLights[i].w * viewLights[i].w)
+							grid.indices[c * MAX_LIGHTS_PER_CLUSTER + count++] = i;
+					}
+					grid.counts[c] = count;
+				}
+			}
+		}
+	}
+}
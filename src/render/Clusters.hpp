@@ -0,0 +1,63 @@
+#ifndef CLUSTERS_HPP
+#define CLUSTERS_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/// Froxel grid for clustered lighting: each view's frustum split into `X * Y` screen tiles and `Z` depth slices,
+/// spaced exponentially between the near and far plane so clusters stay roughly cube shaped. Every cluster lists
+/// the lights whose sphere of influence touches it and fragments only loop over the lights of their own cluster.
+///
+/// Layouts match clusters.glsl, `cull` is the CPU reference of cluster_cull.comp: same math in the same order,
+/// so the GPU's grid can be checked against it.
+namespace clusters {
+	// `CLUSTER_X`, ... in clusters.glsl
+	constexpr uint32_t X = 16, Y = 9, Z = 24;
+	constexpr uint32_t COUNT = X * Y * Z;
+	constexpr uint32_t MAX_LIGHTS = 1024;
+	constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 32; // lights past this are dropped, in index order
+
+	/// std430 `PointLight`
+	struct PointLight {
+		glm::vec3 position; // world space
+		float radius; // no contribution past this distance
+		glm::vec3 color;
+		float intensity;
+	};
+	static_assert(sizeof(PointLight) == 32, "has to match the std430 layout");
+
+	/// `Lights` buffer header, followed by `count` `PointLight`s
+	struct LightsHeader {
+		uint32_t count;
+		uint32_t padding[3]; // `PointLight` is 16 byte aligned
+	};
+
+	/// `Clusters` buffer contents for one view, the buffer holds one per view
+	struct Grid {
+		uint32_t counts[COUNT];
+		uint32_t indices[COUNT * MAX_LIGHTS_PER_CLUSTER]; // `MAX_LIGHTS_PER_CLUSTER` per cluster, first `counts[c]` used
+	};
+
+	/// what culling one view depends on, view space is x right, y down, z forward
+	struct View {
+		glm::mat4 view;
+		glm::mat4 inverseProjection;
+		float zNear, zFar;
+	};
+
+	inline uint32_t index(uint32_t x, uint32_t y, uint32_t z) {
+		return (z * Y + y) * X + x;
+	}
+	/// view space depth where `slice` starts, `slice == Z` is the far plane
+	float sliceDepth(const View &view, uint32_t slice);
+	/// slice containing view space depth `z`, clamped to the grid
+	uint32_t slice(const View &view, float z);
+	/// view space bounding box of a cluster
+	void bounds(const View &view, uint32_t x, uint32_t y, uint32_t z, glm::vec3 &min, glm::vec3 &max);
+
+	/// fills `grid` with the lights touching each cluster
+	void cull(const View &view, const PointLight *lights, uint32_t lightCount, Grid &grid);
+}
+
+#endif //CLUSTERS_HPP
@@ -0,0 +1,142 @@
+#include "Defragmenter.hpp"
+
+#include <algorithm>
+
+void Defragmenter::create(vk::Device device, vk::Queue transferQueue, uint32_t transferQueueFamily, std::mutex *transferQueueMutex) {
+	this->device = device;
+	this->transferQueue = transferQueue;
+	this->transferQueueMutex = transferQueueMutex;
+
+	commandPool = device.createCommandPool(vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, transferQueueFamily));
+	commandBuffer = device.allocateCommandBuffers(vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1))[0];
+	fence = device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlags()));
+}
+void Defragmenter::destroy() {
+	device.destroyFence(fence);
+	device.destroyCommandPool(commandPool);
+	arenas.clear();
+	freeHandles.clear();
+	retired.clear();
+}
+
+Defragmenter::ArenaHandle Defragmenter::registerArena(BufferArena *arena, vk::DeviceSize alignment, MoveCallback moved) {
+	Arena a = {arena, alignment, std::move(moved), true};
+
+	if(!freeHandles.empty()) {
+		ArenaHandle handle = freeHandles.back();
+		freeHandles.pop_back();
+		arenas[handle] = std::move(a);
+		return handle;
+	}
+	arenas.push_back(std::move(a));
+	return arenas.size() - 1;
+}
+void Defragmenter::unregister(ArenaHandle arena) {
+	auto end = std::remove_if(retired.begin(), retired.end(), [&](const Retired &r) {
+		if(r.arena != arena)
+			return false;
+		arenas[arena].arena->free(r.range);
+		return true;
+	});
+	retired.erase(end, retired.end());
+
+	arenas[arena].alive = false;
+	arenas[arena].moved = nullptr;
+	freeHandles.push_back(arena);
+}
+
+float Defragmenter::fragmentation() const {
+	float worst = 0.0f;
+	for(const Arena &a : arenas)
+		if(a.alive)
+			worst = std::max(worst, a.arena->tlsf.stats().fragmentation());
+	return worst;
+}
+
+bool Defragmenter::wantsStep(uint64_t frame) const {
+	if(frame == 0 || frame % interval != 0 || arenas.size() == freeHandles.size())
+		return false;
+	return fragmentation() >= fragmentationThreshold;
+}
+
+bool Defragmenter::step(uint64_t frame) {
+	float fragmentationBefore = fragmentation();
+
+	struct PendingMove {
+		ArenaHandle arena;
+		Move move;
+	};
+	std::vector<PendingMove> moves;
+	vk::DeviceSize bytesMoved = 0;
+
+	commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit, nullptr));
+
+	for(ArenaHandle handle = 0; handle < arenas.size(); handle++) {
+		Arena &a = arenas[handle];
+		if(!a.alive || a.arena->tlsf.stats().fragmentation() < fragmentationThreshold)
+			continue;
+
+		// the old ranges stay allocated until `release`, so nothing moves into memory a frame in flight still reads
+		std::vector<vk::BufferCopy> regions;
+		std::vector<TlsfAllocator::Allocation> allocations = a.arena->tlsf.allocations();
+		for(auto it = allocations.rbegin(); it != allocations.rend(); it++) {
+			if(moves.size() >= maxAllocationsPerStep)
+				break;
+			if(bytesMoved + it->size > maxBytesPerStep)
+				continue;
+			bool isRetired = std::any_of(retired.begin(), retired.end(), [&](const Retired &r) {
+				return r.arena == handle && r.range.allocation.block == it->block;
+			});
+			if(isRetired)
+				continue;
+
+			TlsfAllocator::Allocation to = a.arena->tlsf.allocateFront(it->size, a.alignment);
+			if(!to.valid())
+				continue;
+			if(to.offset >= it->offset) {
+				a.arena->tlsf.free(to); // only moving towards the front compacts anything
+				continue;
+			}
+
+			regions.push_back(vk::BufferCopy(it->offset, to.offset, it->size));
+			moves.push_back({handle, {{it->offset, it->size, *it}, {to.offset, to.size, to}}});
+			bytesMoved += it->size;
+		}
+		// source and destination never overlap, the destination was free
+		if(!regions.empty())
+			commandBuffer.copyBuffer(a.arena->buffer, a.arena->buffer, regions);
+	}
+	commandBuffer.end();
+
+	if(!moves.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(*transferQueueMutex);
+			transferQueue.submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &commandBuffer, 0, nullptr), fence);
+		}
+		device.waitForFences(1, &fence, true, UINT64_MAX);
+		device.resetFences(1, &fence);
+
+		for(const PendingMove &m : moves) {
+			arenas[m.arena].moved(m.move);
+			retired.push_back({m.arena, m.move.from, frame - 1});
+		}
+	}
+	commandBuffer.reset(vk::CommandBufferResetFlags());
+
+	asynclog::logln(litelogger::DEBUG, "Defragmentation step moved %zu ranges (%llu KiB), fragmentation was %.1f%%",
+		moves.size(), (unsigned long long) (bytesMoved >> 10), fragmentationBefore * 100.0f
+	);
+	return !moves.empty();
+}
+void Defragmenter::retire(ArenaHandle arena, const BufferArena::Range &range, uint64_t lastFrame) {
+	retired.push_back({arena, range, lastFrame});
+}
+void Defragmenter::release(uint64_t completedFrame) {
+	auto end = std::remove_if(retired.begin(), retired.end(), [&](const Retired &r) {
+		if(r.lastFrame > completedFrame)
+			return false;
+		arenas[r.arena].arena->free(r.range);
+		return true;
+	});
+	retired.erase(end, retired.end());
+}
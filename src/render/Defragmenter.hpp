@@ -0,0 +1,86 @@
+#ifndef DEFRAGMENTER_HPP
+#define DEFRAGMENTER_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <util/AsyncLog.hpp>
+
+#include <util/BufferArena.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// Incrementally compacts the ranges inside registered `BufferArena`s. The arenas are what
+/// fragments, the big VMA buffers behind them never get freed or moved. Each step moves at most
+/// `maxBytesPerStep` of ranges from the back of an arena into holes further to the front, with
+/// copies recorded on the transfer queue.
+///
+/// Frames still in flight keep reading the old ranges, so those are only given back to the
+/// arena once `release` is told the last frame that could have used them has finished.
+/// Nothing ever waits for the render fences.
+class Defragmenter {
+public:
+	typedef uint32_t ArenaHandle;
+
+	struct Move {
+		BufferArena::Range from;
+		BufferArena::Range to;
+	};
+	/// called once the data is in its new place, the owner has to point everything using `from` at `to`
+	typedef std::function<void(const Move &move)> MoveCallback;
+
+	struct Arena {
+		BufferArena *arena;
+		vk::DeviceSize alignment; // moved ranges get at least this alignment
+		MoveCallback moved;
+
+		bool alive;
+	};
+	/// an old range waiting for the frames that may read it
+	struct Retired {
+		ArenaHandle arena;
+		BufferArena::Range range;
+		uint64_t lastFrame;
+	};
+
+	vk::DeviceSize maxBytesPerStep = 4 * 1024 * 1024;
+	uint32_t maxAllocationsPerStep = 64;
+	float fragmentationThreshold = 0.25f; // only step when an arena is at least this fragmented
+	uint32_t interval = 120; // frames between fragmentation checks
+
+	vk::Device device;
+	vk::Queue transferQueue;
+	std::mutex *transferQueueMutex; // the asset loader submits to the same queue
+
+	vk::CommandPool commandPool;
+	vk::CommandBuffer commandBuffer;
+	vk::Fence fence;
+
+	std::vector<Arena> arenas;
+	std::vector<ArenaHandle> freeHandles;
+	std::vector<Retired> retired;
+public:
+	void create(vk::Device device, vk::Queue transferQueue, uint32_t transferQueueFamily, std::mutex *transferQueueMutex);
+	void destroy();
+
+	ArenaHandle registerArena(BufferArena *arena, vk::DeviceSize alignment, MoveCallback moved);
+	/// gives back the arena's retired ranges right away, only call it once the GPU is done with the arena
+	void unregister(ArenaHandle arena);
+
+	/// fragmentation of the most fragmented arena, see `TlsfAllocator::Stats::fragmentation`
+	float fragmentation() const;
+
+	/// cheap check done every frame, true when it's time to run `step`
+	bool wantsStep(uint64_t frame) const;
+	/// move up to `maxBytesPerStep` bytes, blocks until the copies are done. anything recorded
+	/// from now on has to use the new ranges, frames before `frame` may still read the old ones.
+	/// returns whether anything moved
+	bool step(uint64_t frame);
+	/// free `range` once `release` is told `lastFrame` has finished, for ranges the owner drops itself
+	void retire(ArenaHandle arena, const BufferArena::Range &range, uint64_t lastFrame);
+	/// give the retired ranges of every frame up to `completedFrame` back to their arenas
+	void release(uint64_t completedFrame);
+};
+
+#endif //DEFRAGMENTER_HPP
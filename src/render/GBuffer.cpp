@@ -0,0 +1,82 @@
+#include "GBuffer.hpp"
+
+#include <array>
+#include <tuple>
+
+vk::Format GBuffer::depthFormat(vk::PhysicalDevice physicalDevice) {
+	// D16 is the only one every device has to support, but it's a bit coarse for position reconstruction
+	for(vk::Format f : {vk::Format::eD32Sfloat, vk::Format::eX8D24UnormPack32, vk::Format::eD16Unorm}) {
+		vk::FormatProperties properties = physicalDevice.getFormatProperties(f);
+		if(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+			return f;
+	}
+	return vk::Format::eD16Unorm;
+}
+
+void GBuffer::create(vk::Device device, vk::PhysicalDevice physicalDevice, vma::Allocator allocator, vk::Extent2D extent, uint32_t layers) {
+	this->device = device;
+	this->allocator = allocator;
+	this->extent = extent;
+	this->layers = layers;
+
+	formats[ALBEDO] = COLOR_FORMATS[ALBEDO];
+	formats[NORMAL] = COLOR_FORMATS[NORMAL];
+	formats[DEPTH] = depthFormat(physicalDevice);
+
+	vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+	lazilyAllocated = false;
+	for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		if(memoryProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated)
+			lazilyAllocated = true;
+
+	// transient images may only be used as attachments, which is all these are. not part of a `MemoryBudget`
+	// pool because lazily allocated memory is a memory type of its own and mostly never committed anyway
+	vma::AllocationCreateInfo allocationInfo(vma::AllocationCreateFlags(), lazilyAllocated ? vma::MemoryUsage::eGpuLazilyAllocated : vma::MemoryUsage::eGpuOnly);
+
+	constexpr const char *NAMES[ATTACHMENT_COUNT] = {"G-buffer albedo", "G-buffer normal", "G-buffer depth"};
+	for(uint8_t a = 0; a < ATTACHMENT_COUNT; a++) {
+		bool depth = a == DEPTH;
+		vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransientAttachment | vk::ImageUsageFlagBits::eInputAttachment;
+		usage |= depth ? vk::ImageUsageFlagBits::eDepthStencilAttachment : vk::ImageUsageFlagBits::eColorAttachment;
+
+		std::tie(images[a], allocations[a]) = allocator.createImage(
+			vk::ImageCreateInfo(vk::ImageCreateFlags(),
+				vk::ImageType::e2D, formats[a], vk::Extent3D(extent, 1), 1, layers,
+				vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+				usage
+			),
+			allocationInfo
+		);
+		allocator.setAllocationName(allocations[a], NAMES[a]);
+
+		views[a] = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(),
+			images[a], layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D, formats[a], vk::ComponentMapping(),
+			vk::ImageSubresourceRange(depth ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor, 0, 1, 0, layers)
+		));
+	}
+
+	descriptorPool = nullptr;
+}
+void GBuffer::destroy() {
+	if(descriptorPool)
+		device.destroyDescriptorPool(descriptorPool);
+	for(uint8_t a = 0; a < ATTACHMENT_COUNT; a++) {
+		device.destroyImageView(views[a]);
+		allocator.destroyImage(images[a], allocations[a]);
+	}
+}
+
+void GBuffer::createDescriptorSet(vk::DescriptorSetLayout layout) {
+	vk::DescriptorPoolSize poolSize(vk::DescriptorType::eInputAttachment, ATTACHMENT_COUNT);
+	descriptorPool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlags(), 1, 1, &poolSize));
+	descriptorSet = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool, 1, &layout))[0];
+
+	// the images are shared by all frames in flight, so there's only one set
+	std::array<vk::DescriptorImageInfo, ATTACHMENT_COUNT> imageInfos;
+	std::array<vk::WriteDescriptorSet, ATTACHMENT_COUNT> writes;
+	for(uint8_t a = 0; a < ATTACHMENT_COUNT; a++) {
+		imageInfos[a] = vk::DescriptorImageInfo(nullptr, views[a], a == DEPTH ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal);
+		writes[a] = vk::WriteDescriptorSet(descriptorSet, a, 0, 1, vk::DescriptorType::eInputAttachment, &imageInfos[a], nullptr, nullptr);
+	}
+	device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+}
@@ -0,0 +1,52 @@
+#ifndef GBUFFER_HPP
+#define GBUFFER_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <cstdint>
+
+/// Attachments the geometry subpass writes and the lighting subpass reads back as input attachments at the
+/// same pixel. They never leave the render pass (cleared on load, not stored), so they're transient and live
+/// in lazily allocated memory where the device has it: tile based GPUs keep them in tile memory and never
+/// back them with real memory, everything else just gets regular device local images.
+class GBuffer {
+public:
+	enum Attachment : uint8_t {
+		ALBEDO,
+		NORMAL, // world space, packed to [0, 1]
+		DEPTH,
+		ATTACHMENT_COUNT
+	};
+	static constexpr vk::Format COLOR_FORMATS[DEPTH] = {vk::Format::eR8G8B8A8Unorm, vk::Format::eA2B10G10R10UnormPack32};
+
+	vk::Device device;
+	vma::Allocator allocator;
+
+	vk::Image images[ATTACHMENT_COUNT];
+	vma::Allocation allocations[ATTACHMENT_COUNT];
+	vk::ImageView views[ATTACHMENT_COUNT];
+	vk::Format formats[ATTACHMENT_COUNT];
+	vk::Extent2D extent;
+	uint32_t layers; // one per multiview view
+	bool lazilyAllocated; // false if the device has no lazily allocated memory
+
+	// input attachment `i` is bound at binding `i` of the lighting subpass' set
+	vk::DescriptorPool descriptorPool;
+	vk::DescriptorSet descriptorSet;
+public:
+	/// first depth format the device can render to and read as an input attachment
+	static vk::Format depthFormat(vk::PhysicalDevice physicalDevice);
+
+	void create(vk::Device device, vk::PhysicalDevice physicalDevice, vma::Allocator allocator, vk::Extent2D extent, uint32_t layers);
+	void destroy();
+
+	/// allocates and writes `descriptorSet`, `layout` has to have the input attachments at bindings 0 to 2
+	void createDescriptorSet(vk::DescriptorSetLayout layout);
+
+	vk::Format format(Attachment attachment) const {
+		return formats[attachment];
+	}
+};
+
+#endif //GBUFFER_HPP
@@ -0,0 +1,73 @@
+#include "LayoutCache.hpp"
+
+#include <algorithm>
+
+void LayoutCache::create(vk::Device device) {
+	this->device = device;
+}
+void LayoutCache::destroy() {
+	for(auto &[key, layout] : pipelineLayouts)
+		device.destroyPipelineLayout(layout);
+	for(auto &[key, layout] : setLayouts)
+		device.destroyDescriptorSetLayout(layout);
+	pipelineLayouts.clear();
+	setLayouts.clear();
+}
+
+vk::DescriptorSetLayout LayoutCache::descriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding> &bindings) {
+	std::vector<vk::DescriptorSetLayoutBinding> sorted = bindings;
+	std::sort(sorted.begin(), sorted.end(), [](const vk::DescriptorSetLayoutBinding &a, const vk::DescriptorSetLayoutBinding &b) {
+		return a.binding < b.binding;
+	});
+
+	std::vector<uint64_t> key;
+	for(const vk::DescriptorSetLayoutBinding &b : sorted) {
+		key.push_back((uint64_t) b.binding << 32 | (uint32_t) b.descriptorType);
+		key.push_back((uint64_t) b.descriptorCount << 32 | (VkShaderStageFlags) b.stageFlags);
+		key.push_back(reinterpret_cast<uintptr_t>(b.pImmutableSamplers));
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = setLayouts.find(key);
+	if(found != setLayouts.end())
+		return found->second;
+
+	vk::DescriptorSetLayout layout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo(
+		vk::DescriptorSetLayoutCreateFlags(), sorted.size(), sorted.data()
+	));
+	setLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+vk::PipelineLayout LayoutCache::pipelineLayout(const std::vector<vk::DescriptorSetLayout> &setLayouts, const std::vector<vk::PushConstantRange> &pushConstantRanges) {
+	std::vector<uint64_t> key;
+	key.push_back(setLayouts.size());
+	for(vk::DescriptorSetLayout l : setLayouts)
+		key.push_back(reinterpret_cast<uint64_t>(static_cast<VkDescriptorSetLayout>(l)));
+	for(const vk::PushConstantRange &r : pushConstantRanges) {
+		key.push_back((VkShaderStageFlags) r.stageFlags);
+		key.push_back((uint64_t) r.offset << 32 | r.size);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = pipelineLayouts.find(key);
+	if(found != pipelineLayouts.end())
+		return found->second;
+
+	vk::PipelineLayout layout = device.createPipelineLayout(vk::PipelineLayoutCreateInfo(vk::PipelineLayoutCreateFlags(),
+		setLayouts.size(), setLayouts.data(),
+		pushConstantRanges.size(), pushConstantRanges.data()
+	));
+	pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+vk::PipelineLayout LayoutCache::pipelineLayout(const ShaderReflection &reflection, std::vector<vk::DescriptorSetLayout> *setLayouts) {
+	std::vector<vk::DescriptorSetLayout> layouts;
+	for(uint32_t set = 0; set < reflection.setCount(); set++)
+		layouts.push_back(descriptorSetLayout(reflection.setBindings(set)));
+
+	vk::PipelineLayout layout = pipelineLayout(layouts, reflection.pushConstantRanges);
+	if(setLayouts)
+		*setLayouts = std::move(layouts);
+	return layout;
+}
@@ -0,0 +1,48 @@
+#ifndef LAYOUTCACHE_HPP
+#define LAYOUTCACHE_HPP
+
+#include <vulkan/vulkan.hpp>
+
+#include <render/ShaderReflection.hpp>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/// Hands out one descriptor set layout per distinct binding list and one pipeline layout per distinct set
+/// layouts + push constants combination, so pipelines reflected from the same interface share their layouts.
+/// Everything is owned by the cache and destroyed with it.
+class LayoutCache {
+protected:
+	/// layouts serialized into words, hashed with FNV-1a
+	struct KeyHash {
+		size_t operator()(const std::vector<uint64_t> &key) const {
+			uint64_t h = 0xcbf29ce484222325ull;
+			for(uint64_t w : key)
+				h = (h ^ w) * 0x100000001b3ull;
+			return h;
+		}
+	};
+
+	vk::Device device;
+	std::unordered_map<std::vector<uint64_t>, vk::DescriptorSetLayout, KeyHash> setLayouts;
+	std::unordered_map<std::vector<uint64_t>, vk::PipelineLayout, KeyHash> pipelineLayouts;
+	std::mutex mutex; // startup stages create layouts concurrently
+public:
+	void create(vk::Device device);
+	void destroy();
+
+	vk::DescriptorSetLayout descriptorSetLayout(const std::vector<vk::DescriptorSetLayoutBinding> &bindings);
+	vk::PipelineLayout pipelineLayout(const std::vector<vk::DescriptorSetLayout> &setLayouts, const std::vector<vk::PushConstantRange> &pushConstantRanges);
+	/// set layouts for every set `reflection` uses (empty ones for gaps) and the pipeline layout on top of them
+	vk::PipelineLayout pipelineLayout(const ShaderReflection &reflection, std::vector<vk::DescriptorSetLayout> *setLayouts = nullptr);
+
+	size_t setLayoutCount() const {
+		return setLayouts.size();
+	}
+	size_t pipelineLayoutCount() const {
+		return pipelineLayouts.size();
+	}
+};
+
+#endif //LAYOUTCACHE_HPP
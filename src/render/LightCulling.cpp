@@ -0,0 +1,113 @@
+#include "LightCulling.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <tuple>
+
+void LightCulling::create(vk::Device device, vma::Allocator allocator, uint32_t frameCount, uint32_t viewCount, vk::DeviceSize storageAlignment, bool readback) {
+	this->device = device;
+	this->allocator = allocator;
+	this->frameCount = frameCount;
+	this->viewCount = viewCount;
+	this->readback = readback;
+
+	auto align = [=](vk::DeviceSize size) {
+		return storageAlignment > 0 ? (size + storageAlignment - 1) & ~(storageAlignment - 1) : size;
+	};
+	lightStride = align(sizeof(clusters::LightsHeader) + sizeof(clusters::PointLight) * clusters::MAX_LIGHTS);
+	clusterStride = align(sizeof(clusters::Grid) * viewCount);
+
+	std::tie(lightBuffer, lightAllocation) = allocator.createBuffer(
+		vk::BufferCreateInfo(vk::BufferCreateFlags(), lightStride * frameCount, vk::BufferUsageFlagBits::eStorageBuffer),
+		vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eCpuToGpu)
+	);
+	allocator.setAllocationName(lightAllocation, "Lights");
+	allocator.mapMemory(lightAllocation, reinterpret_cast<void**>(&lightData));
+
+	// only written and read on the GPU, unless it's read back for validation
+	std::tie(clusterBuffer, clusterAllocation) = allocator.createBuffer(
+		vk::BufferCreateInfo(vk::BufferCreateFlags(), clusterStride * frameCount, vk::BufferUsageFlagBits::eStorageBuffer),
+		vma::AllocationCreateInfo(vma::AllocationCreateFlags(), readback ? vma::MemoryUsage::eGpuToCpu : vma::MemoryUsage::eGpuOnly)
+	);
+	allocator.setAllocationName(clusterAllocation, "Light clusters");
+	clusterData = nullptr;
+	if(readback)
+		allocator.mapMemory(clusterAllocation, reinterpret_cast<void**>(&clusterData));
+
+	frameLights.resize(frameCount);
+	frameViews.resize(frameCount);
+	pipeline = nullptr;
+}
+void LightCulling::destroy() {
+	if(pipeline)
+		device.destroyPipeline(pipeline);
+	if(clusterData)
+		allocator.unmapMemory(clusterAllocation);
+	allocator.destroyBuffer(clusterBuffer, clusterAllocation);
+	allocator.unmapMemory(lightAllocation);
+	allocator.destroyBuffer(lightBuffer, lightAllocation);
+}
+
+void LightCulling::createPipeline(vk::ShaderModule shader, vk::PipelineLayout pipelineLayout, vk::PipelineCache cache) {
+	this->pipelineLayout = pipelineLayout;
+	pipeline = device.createComputePipeline(cache, vk::ComputePipelineCreateInfo(vk::PipelineCreateFlags(),
+		vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, shader, "main"),
+		pipelineLayout
+	)).value;
+}
+
+void LightCulling::upload(uint32_t frame, const std::vector<clusters::PointLight> &lights, const std::vector<clusters::View> &views) {
+	clusters::LightsHeader header = {};
+	header.count = std::min<uint32_t>(lights.size(), clusters::MAX_LIGHTS);
+
+	uint8_t *region = lightData + lightStride * frame;
+	memcpy(region, &header, sizeof(header));
+	if(header.count > 0)
+		memcpy(region + sizeof(header), lights.data(), sizeof(clusters::PointLight) * header.count);
+	allocator.flushAllocation(lightAllocation, lightStride * frame, sizeof(header) + sizeof(clusters::PointLight) * header.count);
+
+	if(readback) {
+		frameLights[frame].assign(lights.begin(), lights.begin() + header.count);
+		frameViews[frame] = views;
+	}
+}
+void LightCulling::record(vk::CommandBuffer commandBuffer, vk::DescriptorSet globalDescriptorSet) const {
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, 1, &globalDescriptorSet, 0, nullptr);
+	commandBuffer.dispatch(1, 1, clusters::Z * viewCount);
+
+	vk::MemoryBarrier culled(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | (readback ? vk::AccessFlagBits::eHostRead : vk::AccessFlags()));
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eFragmentShader | (readback ? vk::PipelineStageFlagBits::eHost : vk::PipelineStageFlags()),
+		vk::DependencyFlags(), 1, &culled, 0, nullptr, 0, nullptr
+	);
+}
+
+uint32_t LightCulling::validate(uint32_t frame, const litelogger::Logger &logger) const {
+	if(!readback || frameViews[frame].empty())
+		return 0;
+
+	allocator.invalidateAllocation(clusterAllocation, clusterStride * frame, sizeof(clusters::Grid) * viewCount);
+
+	std::unique_ptr<clusters::Grid> expected = std::make_unique<clusters::Grid>();
+	uint32_t mismatches = 0, lightRefs = 0;
+	for(uint32_t v = 0; v < viewCount && v < frameViews[frame].size(); v++) {
+		const clusters::Grid *gpu = reinterpret_cast<const clusters::Grid*>(clusterData + clusterStride * frame) + v;
+		clusters::cull(frameViews[frame][v], frameLights[frame].data(), frameLights[frame].size(), *expected);
+
+		for(uint32_t c = 0; c < clusters::COUNT; c++) {
+			lightRefs += expected->counts[c];
+			if(gpu->counts[c] != expected->counts[c]
+			|| memcmp(&gpu->indices[c * clusters::MAX_LIGHTS_PER_CLUSTER], &expected->indices[c * clusters::MAX_LIGHTS_PER_CLUSTER], expected->counts[c] * sizeof(uint32_t)) != 0)
+				mismatches++;
+		}
+	}
+
+	if(mismatches > 0)
+		asynclog::logln(litelogger::WARN, "Light clusters: %u of %u clusters differ from the CPU reference", mismatches, clusters::COUNT * viewCount);
+	else
+		asynclog::logln(logger, "Light clusters match the CPU reference, %u light references in %u clusters :)", lightRefs, clusters::COUNT * viewCount);
+	return mismatches;
+}
@@ -0,0 +1,64 @@
+#ifndef LIGHTCULLING_HPP
+#define LIGHTCULLING_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <util/AsyncLog.hpp>
+
+#include <render/Clusters.hpp>
+
+#include <vector>
+
+/// GPU side of clustered lighting. Every frame in flight gets its own region of the `Lights` buffer (written
+/// by the CPU) and of the `Clusters` buffer (written by cluster_cull.comp), `record` dispatches the culling
+/// ahead of the frame's render pass. One workgroup culls one depth slice of one view.
+///
+/// With `readback` the cluster grid lives in host visible memory and `validate` compares what the GPU
+/// produced against `clusters::cull` once the frame is done.
+class LightCulling {
+public:
+	vk::Device device;
+	vma::Allocator allocator;
+	uint32_t frameCount, viewCount;
+
+	vk::Buffer lightBuffer;
+	vma::Allocation lightAllocation;
+	uint8_t *lightData; // persistently mapped
+	vk::DeviceSize lightStride; // one region per frame in flight
+
+	vk::Buffer clusterBuffer;
+	vma::Allocation clusterAllocation;
+	uint8_t *clusterData; // only mapped with `readback`
+	vk::DeviceSize clusterStride;
+
+	vk::PipelineLayout pipelineLayout;
+	vk::Pipeline pipeline;
+
+	bool readback;
+	// what each frame's culling ran on, kept for `validate`
+	std::vector<std::vector<clusters::PointLight>> frameLights;
+	std::vector<std::vector<clusters::View>> frameViews;
+public:
+	void create(vk::Device device, vma::Allocator allocator, uint32_t frameCount, uint32_t viewCount, vk::DeviceSize storageAlignment, bool readback);
+	void destroy();
+
+	/// the compute layout has to share set 0 with the graphics pipelines, the culling shader only uses set 0
+	void createPipeline(vk::ShaderModule shader, vk::PipelineLayout pipelineLayout, vk::PipelineCache cache);
+
+	vk::DescriptorBufferInfo lightBufferInfo(uint32_t frame) const {
+		return vk::DescriptorBufferInfo(lightBuffer, lightStride * frame, sizeof(clusters::LightsHeader) + sizeof(clusters::PointLight) * clusters::MAX_LIGHTS);
+	}
+	vk::DescriptorBufferInfo clusterBufferInfo(uint32_t frame) const {
+		return vk::DescriptorBufferInfo(clusterBuffer, clusterStride * frame, sizeof(clusters::Grid) * viewCount);
+	}
+
+	/// call once the frame's fence has been waited on, lights past `clusters::MAX_LIGHTS` are dropped
+	void upload(uint32_t frame, const std::vector<clusters::PointLight> &lights, const std::vector<clusters::View> &views);
+	/// culling for every view, then a barrier so fragment shaders see the grid
+	void record(vk::CommandBuffer commandBuffer, vk::DescriptorSet globalDescriptorSet) const;
+	/// compares the last grid of `frame` against the CPU reference, needs `readback` and a finished frame.
+	/// returns how many clusters differ, float differences at cluster borders can make a few disagree
+	uint32_t validate(uint32_t frame, const litelogger::Logger &logger) const;
+};
+
+#endif //LIGHTCULLING_HPP
@@ -0,0 +1,90 @@
+#include "MemoryBudget.hpp"
+
+void MemoryBudget::create(vma::Allocator allocator, bool budgetExtension) {
+	this->allocator = allocator;
+	this->budgetExtension = budgetExtension;
+	overBudgetHeaps = 0;
+
+	// representative resources, only used to pick a memory type for each pool
+	vk::BufferCreateInfo geometryInfo(vk::BufferCreateFlags(), 65536,
+		vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst
+	);
+	vk::BufferCreateInfo stagingInfo(vk::BufferCreateFlags(), 65536, vk::BufferUsageFlagBits::eTransferSrc);
+	vk::ImageCreateInfo textureInfo(vk::ImageCreateFlags(),
+		vk::ImageType::e2D, vk::Format::eR8G8B8A8Srgb, vk::Extent3D(256, 256, 1), 1, 1,
+		vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst
+	);
+	vk::ImageCreateInfo renderTargetInfo(vk::ImageCreateFlags(),
+		vk::ImageType::e2D, vk::Format::eR8G8B8A8Unorm, vk::Extent3D(256, 256, 1), 1, 1,
+		vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled
+	);
+
+	uint32_t memoryTypes[USAGE_COUNT] = {
+		// geometry is written through persistently mapped memory, VMA prefers device local + host visible for this
+		allocator.findMemoryTypeIndexForBufferInfo(geometryInfo, vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eCpuToGpu)),
+		allocator.findMemoryTypeIndexForImageInfo(textureInfo, vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eGpuOnly)),
+		allocator.findMemoryTypeIndexForImageInfo(renderTargetInfo, vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eGpuOnly)),
+		allocator.findMemoryTypeIndexForBufferInfo(stagingInfo, vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eCpuOnly))
+	};
+
+	const VkPhysicalDeviceMemoryProperties *memoryProperties;
+	vmaGetMemoryProperties(static_cast<VmaAllocator>(allocator), &memoryProperties);
+	heapCount = memoryProperties->memoryHeapCount;
+
+	for(uint8_t i = 0; i < USAGE_COUNT; i++) {
+		pools[i] = allocator.createPool(vma::PoolCreateInfo(memoryTypes[i]));
+		allocator.setPoolName(pools[i], USAGE_NAMES[i]);
+		poolHeaps[i] = memoryProperties->memoryTypes[memoryTypes[i]].heapIndex;
+	}
+
+	update(0);
+}
+void MemoryBudget::destroy() {
+	for(uint8_t i = 0; i < USAGE_COUNT; i++)
+		allocator.destroyPool(pools[i]);
+}
+
+void MemoryBudget::update(uint32_t frameIndex) {
+	// VMA only refreshes VK_EXT_memory_budget numbers when told about a new frame
+	allocator.setCurrentFrameIndex(frameIndex);
+
+	allocator.getBudget(heapBudgets);
+	for(uint8_t i = 0; i < USAGE_COUNT; i++)
+		allocator.getPoolStats(pools[i], &poolStats[i]);
+
+	for(uint32_t h = 0; h < heapCount; h++) {
+		const vma::Budget &b = heapBudgets[h];
+
+		if(b.budget == 0 || b.usage <= b.budget * evictionThreshold) {
+			overBudgetHeaps &= ~(1u << h);
+			continue;
+		}
+
+		if(!(overBudgetHeaps & (1u << h))) {
+			asynclog::logln(litelogger::WARN, "Memory heap %u is over budget: %llu/%llu MiB used",
+				h, (unsigned long long) (b.usage >> 20), (unsigned long long) (b.budget >> 20)
+			);
+			overBudgetHeaps |= 1u << h;
+		}
+		for(const EvictionCallback &callback : evictionCallbacks)
+			callback(h, b.usage, b.budget);
+	}
+}
+
+void MemoryBudget::logStats(const litelogger::Logger &logger) const {
+	for(uint8_t i = 0; i < USAGE_COUNT; i++) {
+		asynclog::logln(logger, "%s pool (heap %u): %llu/%llu KiB used by %zu allocations in %zu blocks",
+			USAGE_NAMES[i], poolHeaps[i],
+			(unsigned long long) ((poolStats[i].size - poolStats[i].unusedSize) >> 10), (unsigned long long) (poolStats[i].size >> 10),
+			poolStats[i].allocationCount, poolStats[i].blockCount
+		);
+	}
+	for(uint32_t h = 0; h < heapCount; h++) {
+		asynclog::logln(logger, "Heap %u: %llu/%llu MiB used%s",
+			h, (unsigned long long) (heapBudgets[h].usage >> 20), (unsigned long long) (heapBudgets[h].budget >> 20),
+			budgetExtension ? "" : " (estimated)"
+		);
+	}
+}
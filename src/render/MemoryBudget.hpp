@@ -0,0 +1,65 @@
+#ifndef MEMORYBUDGET_HPP
+#define MEMORYBUDGET_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <util/AsyncLog.hpp>
+
+#include <functional>
+#include <vector>
+
+/// Owns one VMA pool per usage class and samples pool usage and heap budgets every frame.
+/// When a heap goes over `evictionThreshold` of its budget every registered eviction
+/// callback is called once per frame until usage drops again.
+class MemoryBudget {
+public:
+	enum Usage : uint8_t {
+		STATIC_GEOMETRY,
+		TEXTURES,
+		RENDER_TARGETS,
+		STAGING,
+		USAGE_COUNT
+	};
+	static constexpr const char *USAGE_NAMES[USAGE_COUNT] = {"Static geometry", "Textures", "Render targets", "Staging"};
+
+	typedef std::function<void(uint32_t heapIndex, vk::DeviceSize usage, vk::DeviceSize budget)> EvictionCallback;
+
+	vma::Allocator allocator;
+	bool budgetExtension; // without VK_EXT_memory_budget the budget is VMA's estimate (80% of the heap)
+
+	vma::Pool pools[USAGE_COUNT];
+	uint32_t poolHeaps[USAGE_COUNT];
+
+	/// sampled by `update`
+	vma::PoolStats poolStats[USAGE_COUNT];
+	vma::Budget heapBudgets[VK_MAX_MEMORY_HEAPS];
+	uint32_t heapCount;
+
+	float evictionThreshold = 0.9f;
+	std::vector<EvictionCallback> evictionCallbacks;
+protected:
+	uint32_t overBudgetHeaps; // bitmask, used to only warn when a heap goes over, not every frame
+public:
+	void create(vma::Allocator allocator, bool budgetExtension);
+	void destroy();
+
+	vma::Pool pool(Usage usage) const {
+		return pools[usage];
+	}
+	vma::AllocationCreateInfo allocationCreateInfo(Usage usage, vma::AllocationCreateFlags flags = vma::AllocationCreateFlags()) const {
+		return vma::AllocationCreateInfo(flags, vma::MemoryUsage::eUnknown,
+			vk::MemoryPropertyFlags(), vk::MemoryPropertyFlags(), 0, pools[usage]
+		);
+	}
+
+	void addEvictionCallback(EvictionCallback &&callback) {
+		evictionCallbacks.push_back(callback);
+	}
+
+	/// call once per frame, after the frame's fence has been waited on
+	void update(uint32_t frameIndex);
+
+	void logStats(const litelogger::Logger &logger) const;
+};
+
+#endif //MEMORYBUDGET_HPP
@@ -0,0 +1,123 @@
+#include "MeshRegistry.hpp"
+
+void MeshRegistry::create(vma::Allocator allocator, vma::Pool pool, vk::DeviceSize vertexStride, vk::DeviceSize vertexCapacity, vk::DeviceSize indexCapacity) {
+	this->vertexStride = vertexStride;
+
+	vma::AllocationCreateInfo allocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eUnknown,
+		vk::MemoryPropertyFlags(), vk::MemoryPropertyFlags(), 0, pool
+	);
+	vertexArena.create(allocator, "Vertex arena", vertexCapacity,
+		vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+		allocationCreateInfo
+	);
+	indexArena.create(allocator, "Index arena", indexCapacity,
+		vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+		allocationCreateInfo
+	);
+}
+void MeshRegistry::destroy(vma::Allocator allocator) {
+	indexArena.destroy(allocator);
+	vertexArena.destroy(allocator);
+	meshes.clear();
+	freeHandles.clear();
+}
+
+MeshRegistry::MeshHandle MeshRegistry::add(const void *vertices, uint32_t vertexCount, const uint16_t *indices, uint32_t indexCount) {
+	return add(vertices, vertexCount, indices, indexCount, vk::IndexType::eUint16);
+}
+MeshRegistry::MeshHandle MeshRegistry::add(const void *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount) {
+	return add(vertices, vertexCount, indices, indexCount, vk::IndexType::eUint32);
+}
+MeshRegistry::MeshHandle MeshRegistry::add(const void *vertices, uint32_t vertexCount, const void *indices, uint32_t indexCount, vk::IndexType indexType) {
+	MeshHandle handle = reserve(vertexCount, indexCount, indexType);
+	const Mesh &mesh = meshes[handle];
+
+	vertexArena.write(mesh.vertexRange, vertices, vertexCount * vertexStride);
+	indexArena.write(mesh.indexRange, indices, indexCount * (indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+	return handle;
+}
+MeshRegistry::MeshHandle MeshRegistry::reserve(uint32_t vertexCount, uint32_t indexCount, vk::IndexType indexType) {
+	vk::DeviceSize indexSize = indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	Mesh mesh;
+	mesh.vertexRange = vertexArena.allocate(vertexCount * vertexStride, vertexStride);
+	// the index buffer is always bound at offset 0, so ranges must be aligned to the index size
+	mesh.indexRange = indexArena.allocate(indexCount * indexSize, indexSize);
+
+	mesh.vertexOffset = mesh.vertexRange.offset / vertexStride;
+	mesh.firstIndex = mesh.indexRange.offset / indexSize;
+	mesh.indexCount = indexCount;
+	mesh.indexType = indexType;
+	mesh.alive = true;
+
+	if(!freeHandles.empty()) {
+		MeshHandle handle = freeHandles.back();
+		freeHandles.pop_back();
+		meshes[handle] = mesh;
+		return handle;
+	}
+	meshes.push_back(mesh);
+	return meshes.size() - 1;
+}
+void MeshRegistry::remove(MeshHandle mesh) {
+	if(mesh >= meshes.size() || !meshes[mesh].alive)
+		return;
+
+	if(retire) {
+		retire(vertexArena, meshes[mesh].vertexRange);
+		retire(indexArena, meshes[mesh].indexRange);
+	} else {
+		vertexArena.free(meshes[mesh].vertexRange);
+		indexArena.free(meshes[mesh].indexRange);
+	}
+	meshes[mesh].alive = false;
+	freeHandles.push_back(mesh);
+}
+void MeshRegistry::moveVertices(const BufferArena::Range &from, const BufferArena::Range &to) {
+	for(Mesh &m : meshes) {
+		if(m.alive && m.vertexRange.allocation.block == from.allocation.block) {
+			m.vertexRange = to;
+			m.vertexOffset = to.offset / vertexStride;
+			return;
+		}
+	}
+}
+void MeshRegistry::moveIndices(const BufferArena::Range &from, const BufferArena::Range &to) {
+	for(Mesh &m : meshes) {
+		if(m.alive && m.indexRange.allocation.block == from.allocation.block) {
+			m.indexRange = to;
+			m.firstIndex = to.offset / (m.indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t));
+			return;
+		}
+	}
+}
+
+void MeshRegistry::bind(vk::CommandBuffer commandBuffer) {
+	commandBuffer.bindVertexBuffers(0, {vertexArena.buffer}, {0});
+	commandBuffer.bindIndexBuffer(indexArena.buffer, 0, vk::IndexType::eUint32);
+	boundIndexType = vk::IndexType::eUint32;
+}
+void MeshRegistry::draw(vk::CommandBuffer commandBuffer, MeshHandle mesh, uint32_t instanceCount, uint32_t firstInstance) {
+	const Mesh &m = meshes[mesh];
+
+	if(m.indexType != boundIndexType) {
+		commandBuffer.bindIndexBuffer(indexArena.buffer, 0, m.indexType);
+		boundIndexType = m.indexType;
+	}
+	commandBuffer.drawIndexed(m.indexCount, instanceCount, m.firstIndex, m.vertexOffset, firstInstance);
+}
+void MeshRegistry::drawIndirect(vk::CommandBuffer commandBuffer, MeshHandle mesh, vk::Buffer buffer, vk::DeviceSize offset) {
+	const Mesh &m = meshes[mesh];
+
+	if(m.indexType != boundIndexType) {
+		commandBuffer.bindIndexBuffer(indexArena.buffer, 0, m.indexType);
+		boundIndexType = m.indexType;
+	}
+	commandBuffer.drawIndexedIndirect(buffer, offset, 1, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+void MeshRegistry::logStats(const litelogger::Logger &logger) const {
+	asynclog::logln(logger, "Mesh registry: %zu meshes", meshes.size() - freeHandles.size());
+	vertexArena.logStats(logger);
+	indexArena.logStats(logger);
+}
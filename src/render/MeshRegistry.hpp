@@ -0,0 +1,77 @@
+#ifndef MESHREGISTRY_HPP
+#define MESHREGISTRY_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <util/BufferArena.hpp>
+
+#include <functional>
+#include <vector>
+
+/// Keeps every mesh's vertices and indices in two shared mega buffers so a frame binds
+/// them once and then only issues `drawIndexed` calls with base vertex/first index offsets.
+class MeshRegistry {
+public:
+	typedef uint32_t MeshHandle;
+	static constexpr MeshHandle INVALID_MESH = UINT32_MAX;
+
+	struct Mesh {
+		BufferArena::Range vertexRange;
+		BufferArena::Range indexRange;
+
+		int32_t vertexOffset; // base vertex, in vertices
+		uint32_t firstIndex; // in indices of `indexType`
+		uint32_t indexCount;
+		vk::IndexType indexType;
+
+		bool alive;
+	};
+
+	BufferArena vertexArena;
+	BufferArena indexArena;
+	vk::DeviceSize vertexStride;
+
+	std::vector<Mesh> meshes;
+	std::vector<MeshHandle> freeHandles;
+
+	/// when set, `remove` hands the ranges to it instead of freeing them, so frames in flight can keep reading them
+	std::function<void(BufferArena &arena, const BufferArena::Range &range)> retire;
+protected:
+	vk::IndexType boundIndexType;
+public:
+	void create(vma::Allocator allocator, vma::Pool pool, vk::DeviceSize vertexStride, vk::DeviceSize vertexCapacity, vk::DeviceSize indexCapacity);
+	void destroy(vma::Allocator allocator);
+
+	MeshHandle add(const void *vertices, uint32_t vertexCount, const uint16_t *indices, uint32_t indexCount);
+	MeshHandle add(const void *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount);
+	template<typename V, typename I>
+	MeshHandle add(const std::vector<V> &vertices, const std::vector<I> &indices) {
+		return add(vertices.data(), vertices.size(), indices.data(), indices.size());
+	}
+	/// allocates the ranges without writing anything, for meshes whose data is uploaded later on the transfer queue
+	MeshHandle reserve(uint32_t vertexCount, uint32_t indexCount, vk::IndexType indexType);
+	void remove(MeshHandle mesh);
+
+	/// point the mesh that used `from` at `to` once its data was copied there, e.g. by the defragmenter
+	void moveVertices(const BufferArena::Range &from, const BufferArena::Range &to);
+	void moveIndices(const BufferArena::Range &from, const BufferArena::Range &to);
+
+	const Mesh &get(MeshHandle mesh) const {
+		return meshes[mesh];
+	}
+
+	/// bind the shared vertex and index buffers, once per command buffer
+	void bind(vk::CommandBuffer commandBuffer);
+	/// only rebinds the index buffer when the index type differs from the previous draw,
+	/// so sorting draws by index type keeps that to at most one rebind per frame
+	void draw(vk::CommandBuffer commandBuffer, MeshHandle mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+	/// same, but the command comes from `buffer`, which has to use `mesh`'s index range
+	void drawIndirect(vk::CommandBuffer commandBuffer, MeshHandle mesh, vk::Buffer buffer, vk::DeviceSize offset);
+
+	void logStats(const litelogger::Logger &logger) const;
+protected:
+	MeshHandle add(const void *vertices, uint32_t vertexCount, const void *indices, uint32_t indexCount, vk::IndexType indexType);
+};
+
+#endif //MESHREGISTRY_HPP
@@ -0,0 +1,85 @@
+#include "MultiviewTarget.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <vector>
+
+uint32_t MultiviewTarget::columns(uint32_t viewCount) {
+	// 2 views side by side for stereo, 3 and 4 in a 2x2 grid
+	return static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(viewCount))));
+}
+vk::Extent2D MultiviewTarget::viewExtent(vk::Extent2D output, uint32_t viewCount) {
+	uint32_t cols = columns(viewCount);
+	uint32_t rows = (viewCount + cols - 1) / cols;
+	return vk::Extent2D(std::max(output.width / cols, 1u), std::max(output.height / rows, 1u));
+}
+
+void MultiviewTarget::create(vk::Device device, vma::Allocator allocator, const vma::AllocationCreateInfo &allocationInfo, vk::Format format, vk::Extent2D output, uint32_t viewCount) {
+	this->device = device;
+	this->allocator = allocator;
+	this->format = format;
+	this->viewCount = viewCount;
+	extent = viewExtent(output, viewCount);
+
+	std::tie(image, allocation) = allocator.createImage(
+		vk::ImageCreateInfo(vk::ImageCreateFlags(),
+			vk::ImageType::e2D, format, vk::Extent3D(extent, 1), 1, viewCount,
+			vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc
+		),
+		allocationInfo
+	);
+	allocator.setAllocationName(allocation, "Multiview target");
+
+	view = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(),
+		image, vk::ImageViewType::e2DArray, format, vk::ComponentMapping(),
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, viewCount)
+	));
+}
+void MultiviewTarget::destroy() {
+	device.destroyImageView(view);
+	allocator.destroyImage(image, allocation);
+}
+
+void MultiviewTarget::present(vk::CommandBuffer commandBuffer, vk::Image output, vk::Extent2D outputExtent, const vk::ClearColorValue &background) const {
+	vk::ImageSubresourceRange outputRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+	// the source stage is the one the acquire semaphore waits on, so the transition waits for the image too
+	vk::ImageMemoryBarrier toTransfer(
+		vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite,
+		vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		output, outputRange
+	);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+	// the grid rarely covers the whole image
+	commandBuffer.clearColorImage(output, vk::ImageLayout::eTransferDstOptimal, background, outputRange);
+	vk::MemoryBarrier clearDone(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 1, &clearDone, 0, nullptr, 0, nullptr);
+
+	uint32_t cols = columns(viewCount);
+	uint32_t rows = (viewCount + cols - 1) / cols;
+	int32_t marginX = (outputExtent.width - cols * extent.width) / 2;
+	int32_t marginY = (outputExtent.height - rows * extent.height) / 2;
+
+	// same format and size on both ends, a plain copy needs no blit support from the swapchain format
+	std::vector<vk::ImageCopy> copies;
+	for(uint32_t v = 0; v < viewCount; v++) {
+		copies.push_back(vk::ImageCopy(
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, v, 1), vk::Offset3D(0, 0, 0),
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), vk::Offset3D(marginX + (v % cols) * extent.width, marginY + (v / cols) * extent.height, 0),
+			vk::Extent3D(extent, 1)
+		));
+	}
+	commandBuffer.copyImage(image, vk::ImageLayout::eTransferSrcOptimal, output, vk::ImageLayout::eTransferDstOptimal, copies.size(), copies.data());
+
+	vk::ImageMemoryBarrier toPresent(
+		vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(),
+		vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		output, outputRange
+	);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toPresent);
+}
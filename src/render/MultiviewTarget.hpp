@@ -0,0 +1,42 @@
+#ifndef MULTIVIEWTARGET_HPP
+#define MULTIVIEWTARGET_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <cstdint>
+
+/// Color image with one array layer per view. A single multiview pass (view mask `viewMask()`) renders every
+/// view into its own layer, `gl_ViewIndex` picks the view's matrices, so each extra view costs no extra draws
+/// on the CPU. `present` then copies the layers side by side into the swapchain image for split-screen and
+/// stereo previews.
+class MultiviewTarget {
+public:
+	vk::Device device;
+	vma::Allocator allocator;
+
+	vk::Image image;
+	vma::Allocation allocation;
+	vk::ImageView view; // 2D array over all layers, the pass' color attachment
+	vk::Format format;
+	vk::Extent2D extent; // of one view
+	uint32_t viewCount;
+public:
+	/// largest view extent that fits `viewCount` views into a grid on `output`
+	static vk::Extent2D viewExtent(vk::Extent2D output, uint32_t viewCount);
+	static uint32_t columns(uint32_t viewCount);
+
+	void create(vk::Device device, vma::Allocator allocator, const vma::AllocationCreateInfo &allocationInfo, vk::Format format, vk::Extent2D output, uint32_t viewCount);
+	void destroy();
+
+	uint32_t viewMask() const {
+		return (1u << viewCount) - 1;
+	}
+
+	/// `image` has to be in `TRANSFER_SRC_OPTIMAL` with the color writes done. clears `output` and copies
+	/// every view into its grid cell, leaving `output` in `PRESENT_SRC_KHR`. the acquire semaphore has to
+	/// be waited on at the transfer stage
+	void present(vk::CommandBuffer commandBuffer, vk::Image output, vk::Extent2D outputExtent, const vk::ClearColorValue &background) const;
+};
+
+#endif //MULTIVIEWTARGET_HPP
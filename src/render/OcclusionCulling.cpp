@@ -0,0 +1,214 @@
+#include "OcclusionCulling.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <tuple>
+
+/// `Constants` in occlusion_cull.comp
+struct CullConstants {
+	uint32_t objectCount;
+	uint32_t phase;
+	uint32_t viewCount;
+};
+
+vk::Extent2D OcclusionCulling::pyramidSize(vk::Extent2D depthExtent) {
+	// rounded down, so every level is exactly half the one below and a texel never covers more than 3x3 depth texels
+	return vk::Extent2D(std::bit_floor(std::max(depthExtent.width, 1u)), std::bit_floor(std::max(depthExtent.height, 1u)));
+}
+
+void OcclusionCulling::create(vk::Device device, vma::Allocator allocator, uint32_t frameCount, vk::Image depthImage, vk::Format depthFormat, vk::Extent2D depthExtent, uint32_t viewCount, vk::DeviceSize storageAlignment) {
+	this->device = device;
+	this->allocator = allocator;
+	this->frameCount = frameCount;
+	this->viewCount = viewCount;
+
+	pyramidExtent = pyramidSize(depthExtent);
+	levelCount = std::bit_width(std::max(pyramidExtent.width, pyramidExtent.height));
+
+	std::tie(pyramid, pyramidAllocation) = allocator.createImage(
+		vk::ImageCreateInfo(vk::ImageCreateFlags(),
+			vk::ImageType::e2D, vk::Format::eR32Sfloat, vk::Extent3D(pyramidExtent, 1), levelCount, viewCount,
+			vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst
+		),
+		vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eGpuOnly)
+	);
+	allocator.setAllocationName(pyramidAllocation, "Hi-Z pyramid");
+
+	pyramidView = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(),
+		pyramid, vk::ImageViewType::e2DArray, vk::Format::eR32Sfloat, vk::ComponentMapping(),
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, viewCount)
+	));
+	levelViews.resize(levelCount);
+	for(uint32_t l = 0; l < levelCount; l++)
+		levelViews[l] = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(),
+			pyramid, vk::ImageViewType::e2DArray, vk::Format::eR32Sfloat, vk::ComponentMapping(),
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, l, 1, 0, viewCount)
+		));
+	depthView = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(),
+		depthImage, vk::ImageViewType::e2DArray, depthFormat, vk::ComponentMapping(),
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, viewCount)
+	));
+	sampler = device.createSampler(vk::SamplerCreateInfo(vk::SamplerCreateFlags(),
+		vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest,
+		vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+		0.0f, VK_FALSE, 1.0f, VK_FALSE, vk::CompareOp::eAlways, 0.0f, VK_LOD_CLAMP_NONE
+	));
+
+	auto align = [=](vk::DeviceSize size) {
+		return storageAlignment > 0 ? (size + storageAlignment - 1) & ~(storageAlignment - 1) : size;
+	};
+	objectStride = align(sizeof(Object) * MAX_OBJECTS);
+	commandStride = align(sizeof(vk::DrawIndexedIndirectCommand) * MAX_OBJECTS * 2);
+
+	std::tie(objectBuffer, objectAllocation) = allocator.createBuffer(
+		vk::BufferCreateInfo(vk::BufferCreateFlags(), objectStride * frameCount, vk::BufferUsageFlagBits::eStorageBuffer),
+		vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eCpuToGpu)
+	);
+	allocator.setAllocationName(objectAllocation, "Occlusion culling objects");
+	allocator.mapMemory(objectAllocation, reinterpret_cast<void**>(&objectData));
+
+	std::tie(commandBuffer, commandAllocation) = allocator.createBuffer(
+		vk::BufferCreateInfo(vk::BufferCreateFlags(), commandStride * frameCount, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer),
+		vma::AllocationCreateInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eGpuOnly)
+	);
+	allocator.setAllocationName(commandAllocation, "Occlusion culling commands");
+
+	descriptorPool = nullptr;
+	buildPipeline = nullptr;
+	cullPipeline = nullptr;
+	initialized = false;
+}
+void OcclusionCulling::destroy() {
+	if(cullPipeline)
+		device.destroyPipeline(cullPipeline);
+	if(buildPipeline)
+		device.destroyPipeline(buildPipeline);
+	if(descriptorPool)
+		device.destroyDescriptorPool(descriptorPool);
+
+	allocator.destroyBuffer(commandBuffer, commandAllocation);
+	allocator.unmapMemory(objectAllocation);
+	allocator.destroyBuffer(objectBuffer, objectAllocation);
+
+	device.destroySampler(sampler);
+	device.destroyImageView(depthView);
+	for(vk::ImageView v : levelViews)
+		device.destroyImageView(v);
+	device.destroyImageView(pyramidView);
+	allocator.destroyImage(pyramid, pyramidAllocation);
+}
+
+void OcclusionCulling::createPipelines(vk::ShaderModule buildShader, vk::DescriptorSetLayout buildSetLayout, vk::PipelineLayout buildPipelineLayout,
+	vk::ShaderModule cullShader, vk::DescriptorSetLayout cullSetLayout, vk::PipelineLayout cullPipelineLayout, vk::PipelineCache cache) {
+	this->buildPipelineLayout = buildPipelineLayout;
+	this->cullPipelineLayout = cullPipelineLayout;
+
+	buildPipeline = device.createComputePipeline(cache, vk::ComputePipelineCreateInfo(vk::PipelineCreateFlags(),
+		vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, buildShader, "main"),
+		buildPipelineLayout
+	)).value;
+	cullPipeline = device.createComputePipeline(cache, vk::ComputePipelineCreateInfo(vk::PipelineCreateFlags(),
+		vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, cullShader, "main"),
+		cullPipelineLayout
+	)).value;
+
+	std::array<vk::DescriptorPoolSize, 3> poolSizes = {
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, levelCount + frameCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, levelCount),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 2 * frameCount)
+	};
+	descriptorPool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlags(), levelCount + frameCount, poolSizes.size(), poolSizes.data()));
+
+	// level 0 reduces the depth buffer, every other level the one below it
+	std::vector<vk::DescriptorSetLayout> buildLayouts(levelCount, buildSetLayout);
+	buildSets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool, buildLayouts.size(), buildLayouts.data()));
+	for(uint32_t l = 0; l < levelCount; l++) {
+		vk::DescriptorImageInfo source(sampler, l == 0 ? depthView : levelViews[l - 1], l == 0 ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eGeneral);
+		vk::DescriptorImageInfo destination(nullptr, levelViews[l], vk::ImageLayout::eGeneral);
+		std::array<vk::WriteDescriptorSet, 2> writes = {
+			vk::WriteDescriptorSet(buildSets[l], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &source, nullptr, nullptr),
+			vk::WriteDescriptorSet(buildSets[l], 1, 0, 1, vk::DescriptorType::eStorageImage, &destination, nullptr, nullptr)
+		};
+		device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+	}
+
+	std::vector<vk::DescriptorSetLayout> cullLayouts(frameCount, cullSetLayout);
+	cullSets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool, cullLayouts.size(), cullLayouts.data()));
+	for(uint32_t f = 0; f < frameCount; f++) {
+		vk::DescriptorBufferInfo objects(objectBuffer, objectStride * f, sizeof(Object) * MAX_OBJECTS);
+		vk::DescriptorBufferInfo commands(commandBuffer, commandStride * f, sizeof(vk::DrawIndexedIndirectCommand) * MAX_OBJECTS * 2);
+		vk::DescriptorImageInfo levels(sampler, pyramidView, vk::ImageLayout::eGeneral);
+		std::array<vk::WriteDescriptorSet, 3> writes = {
+			vk::WriteDescriptorSet(cullSets[f], 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &objects, nullptr),
+			vk::WriteDescriptorSet(cullSets[f], 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &commands, nullptr),
+			vk::WriteDescriptorSet(cullSets[f], 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &levels, nullptr, nullptr)
+		};
+		device.updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+	}
+}
+
+void OcclusionCulling::upload(uint32_t frame, const std::vector<Object> &objects) {
+	size_t count = std::min<size_t>(objects.size(), MAX_OBJECTS);
+	if(count == 0)
+		return;
+	memcpy(objectData + objectStride * frame, objects.data(), sizeof(Object) * count);
+	allocator.flushAllocation(objectAllocation, objectStride * frame, sizeof(Object) * count);
+}
+
+void OcclusionCulling::recordInit(vk::CommandBuffer commandBuffer) {
+	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, viewCount);
+
+	vk::ImageMemoryBarrier toGeneral(
+		vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite,
+		vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		pyramid, range
+	);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toGeneral);
+
+	// the far plane everywhere, nothing is occluded until there's a real pyramid
+	vk::ClearColorValue far(std::array<float, 4>{1.0f, 1.0f, 1.0f, 1.0f});
+	commandBuffer.clearColorImage(pyramid, vk::ImageLayout::eGeneral, &far, 1, &range);
+
+	vk::MemoryBarrier cleared(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 1, &cleared, 0, nullptr, 0, nullptr);
+
+	initialized = true;
+}
+
+void OcclusionCulling::recordCull(vk::CommandBuffer commandBuffer, uint32_t frame, vk::DescriptorSet globalDescriptorSet, uint32_t phase, uint32_t objectCount) const {
+	CullConstants constants = {std::min(objectCount, MAX_OBJECTS), phase, viewCount};
+	std::array<vk::DescriptorSet, 2> sets = {globalDescriptorSet, cullSets[frame]};
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout, 0, sets.size(), sets.data(), 0, nullptr);
+	commandBuffer.pushConstants(cullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+	commandBuffer.dispatch((constants.objectCount + 63) / 64, 1, 1);
+
+	// phase 1 also reads what phase 0 decided
+	vk::MemoryBarrier culled(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead);
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader,
+		vk::DependencyFlags(), 1, &culled, 0, nullptr, 0, nullptr
+	);
+}
+
+void OcclusionCulling::recordPyramid(vk::CommandBuffer commandBuffer) const {
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, buildPipeline);
+
+	// phase 0 still reads the old pyramid
+	vk::MemoryBarrier levelDone(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 1, &levelDone, 0, nullptr, 0, nullptr);
+
+	for(uint32_t l = 0; l < levelCount; l++) {
+		uint32_t width = std::max(pyramidExtent.width >> l, 1u), height = std::max(pyramidExtent.height >> l, 1u);
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, buildPipelineLayout, 0, 1, &buildSets[l], 0, nullptr);
+		commandBuffer.dispatch((width + 7) / 8, (height + 7) / 8, viewCount);
+
+		// the next level reads this one, after the last one phase 1 and the next frame's phase 0 read all of them
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(), 1, &levelDone, 0, nullptr, 0, nullptr);
+	}
+}
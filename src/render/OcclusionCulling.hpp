@@ -0,0 +1,91 @@
+#ifndef OCCLUSIONCULLING_HPP
+#define OCCLUSIONCULLING_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// Two phase GPU occlusion culling against a hierarchical depth (Hi-Z) pyramid, every texel holding the farthest
+/// depth of the texels below it. Objects are drawn indirectly, the culling only decides each command's instance count.
+///
+///  1. `recordCull(0)` tests every object against the pyramid left by the previous frame, the survivors are drawn
+///  2. `recordPyramid` rebuilds the pyramid from the depth those draws produced
+///  3. `recordCull(1)` retests only what phase 0 culled against the new pyramid, so objects that just came into
+///     view (disoccluded, or culled because the camera moved) are drawn in the same frame instead of popping in
+///
+/// The pyramid left after phase 1 is what the next frame's phase 0 uses. Bindings of the shaders' own set, which
+/// the caller derives the layouts from: hiz_build.comp set 0 has the source level at 0 and the destination at 1,
+/// occlusion_cull.comp set 1 has `Objects` at 0, `Commands` at 1 and the pyramid at 2.
+class OcclusionCulling {
+public:
+	static constexpr uint32_t MAX_OBJECTS = 4096; // `MAX_OBJECTS` in occlusion_cull.comp, draws past it aren't culled
+
+	/// std430 `Object`
+	struct Object {
+		glm::vec4 boundsMin; // world space, w unused
+		glm::vec4 boundsMax;
+		uint32_t indexCount, firstIndex; // the indirect command drawing it, minus the instance count
+		int32_t vertexOffset;
+		uint32_t padding;
+	};
+	static_assert(sizeof(Object) == 48, "has to match the std430 layout");
+
+	vk::Device device;
+	vma::Allocator allocator;
+	uint32_t frameCount, viewCount;
+
+	vk::Image pyramid;
+	vma::Allocation pyramidAllocation;
+	vk::ImageView pyramidView; // every level, for the culling
+	std::vector<vk::ImageView> levelViews; // one level each, for building
+	vk::Extent2D pyramidExtent; // level 0, the depth buffer rounded down to powers of two
+	uint32_t levelCount;
+	vk::ImageView depthView; // array view of the depth buffer, for building level 0
+	vk::Sampler sampler; // nearest, everything is fetched by texel
+
+	vk::Buffer objectBuffer;
+	vma::Allocation objectAllocation;
+	uint8_t *objectData; // persistently mapped
+	vk::DeviceSize objectStride; // one region per frame in flight
+
+	vk::Buffer commandBuffer; // `vk::DrawIndexedIndirectCommand`s, phase 0's then phase 1's
+	vma::Allocation commandAllocation;
+	vk::DeviceSize commandStride;
+
+	vk::DescriptorPool descriptorPool;
+	std::vector<vk::DescriptorSet> buildSets; // one per pyramid level
+	std::vector<vk::DescriptorSet> cullSets; // one per frame in flight
+	vk::PipelineLayout buildPipelineLayout, cullPipelineLayout;
+	vk::Pipeline buildPipeline, cullPipeline;
+
+	bool initialized; // the pyramid gets cleared to the far plane by `recordInit` before its first use
+public:
+	static vk::Extent2D pyramidSize(vk::Extent2D depthExtent);
+
+	void create(vk::Device device, vma::Allocator allocator, uint32_t frameCount, vk::Image depthImage, vk::Format depthFormat, vk::Extent2D depthExtent, uint32_t viewCount, vk::DeviceSize storageAlignment);
+	void destroy();
+
+	/// `cullPipelineLayout` has the global set at 0 and `cullSetLayout` at 1
+	void createPipelines(vk::ShaderModule buildShader, vk::DescriptorSetLayout buildSetLayout, vk::PipelineLayout buildPipelineLayout,
+		vk::ShaderModule cullShader, vk::DescriptorSetLayout cullSetLayout, vk::PipelineLayout cullPipelineLayout, vk::PipelineCache cache);
+
+	/// where object `index`'s command for `phase` is in `commandBuffer`
+	vk::DeviceSize commandOffset(uint32_t frame, uint32_t phase, uint32_t index) const {
+		return commandStride * frame + (phase * MAX_OBJECTS + index) * sizeof(vk::DrawIndexedIndirectCommand);
+	}
+
+	/// call once the frame's fence has been waited on, objects past `MAX_OBJECTS` are dropped
+	void upload(uint32_t frame, const std::vector<Object> &objects);
+
+	/// clears the pyramid so the first frame culls nothing, has to run once before anything else
+	void recordInit(vk::CommandBuffer commandBuffer);
+	/// writes `objectCount` commands of `phase`, then a barrier for the indirect draws
+	void recordCull(vk::CommandBuffer commandBuffer, uint32_t frame, vk::DescriptorSet globalDescriptorSet, uint32_t phase, uint32_t objectCount) const;
+	/// the depth buffer has to be in `eDepthStencilReadOnlyOptimal` with its writes visible to compute shaders
+	void recordPyramid(vk::CommandBuffer commandBuffer) const;
+};
+
+#endif //OCCLUSIONCULLING_HPP
@@ -0,0 +1,52 @@
+#include "PipelineVariants.hpp"
+
+void PipelineVariants::create(vk::Device device, ShaderFeatures declared, Builder &&builder) {
+	this->device = device;
+	this->declared = declared & ((1 << FEATURE_COUNT) - 1);
+	this->builder = std::move(builder);
+	pipelines.fill(vk::Pipeline());
+	built = 0;
+}
+void PipelineVariants::destroy() {
+	clear();
+}
+void PipelineVariants::clear() {
+	for(vk::Pipeline &p : pipelines) {
+		if(p)
+			device.destroyPipeline(p);
+		p = vk::Pipeline();
+	}
+	built = 0;
+}
+
+void PipelineVariants::prebuild(uint32_t keys) {
+	for(uint32_t key = 0; key < pipelines.size(); key++)
+		if(keys & (1u << key))
+			ensure(key & declared);
+}
+void PipelineVariants::swap(PipelineVariants &other) {
+	std::swap(device, other.device);
+	std::swap(declared, other.declared);
+	std::swap(builder, other.builder);
+	std::swap(pipelines, other.pipelines);
+	built = other.built.exchange(built.load());
+}
+
+vk::Pipeline PipelineVariants::ensure(uint32_t key) {
+	vk::Pipeline &p = pipelines[key];
+	if(!p) {
+		p = build(key);
+		built.fetch_or(1u << key);
+	}
+	return p;
+}
+vk::Pipeline PipelineVariants::build(ShaderFeatures features) {
+	std::array<vk::SpecializationMapEntry, FEATURE_COUNT> entries;
+	std::array<vk::Bool32, FEATURE_COUNT> values;
+	for(uint32_t i = 0; i < FEATURE_COUNT; i++) {
+		entries[i] = vk::SpecializationMapEntry(i, i * sizeof(vk::Bool32), sizeof(vk::Bool32));
+		values[i] = (features >> i) & 1;
+	}
+	vk::SpecializationInfo specialization(entries.size(), entries.data(), sizeof(values), values.data());
+	return builder(specialization);
+}
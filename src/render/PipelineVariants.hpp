@@ -0,0 +1,66 @@
+#ifndef PIPELINEVARIANTS_HPP
+#define PIPELINEVARIANTS_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <util/AsyncLog.hpp>
+
+#include <array>
+#include <atomic>
+#include <functional>
+
+/// Optional shader features. Bit `i` maps to `layout(constant_id = i) const bool` in the shaders, so a feature
+/// that's off becomes a constant `false` the driver folds away instead of a runtime branch in an uber-shader.
+enum ShaderFeature : uint32_t {
+	FEATURE_NONE = 0,
+	FEATURE_VERTEX_COLOR = 1 << 0,
+	FEATURE_TEXTURING = 1 << 1,
+	FEATURE_SKINNING = 1 << 2,
+	FEATURE_ALPHA_TEST = 1 << 3,
+
+	FEATURE_COUNT = 4
+};
+typedef uint32_t ShaderFeatures;
+
+/// One pipeline per feature combination of the same shaders, specialized with `ShaderFeature` constants.
+/// Lookups index a flat table by the feature bits. Variants are meant to be built up front with `prebuild`,
+/// one that wasn't is still built on first use, with a warning since that stalls whoever asked. Features the
+/// shaders don't declare are masked out of the key so they don't create identical pipelines.
+class PipelineVariants {
+public:
+	/// creates the pipeline for one variant, `specialization` has to be passed to every stage
+	typedef std::function<vk::Pipeline(const vk::SpecializationInfo &specialization)> Builder;
+protected:
+	vk::Device device;
+	ShaderFeatures declared; // by the shaders, from `ShaderReflection::specializationConstants`
+	Builder builder;
+	std::array<vk::Pipeline, 1 << FEATURE_COUNT> pipelines;
+	std::atomic<uint32_t> built; // bit per key, read by whoever rebuilds the variants
+public:
+	void create(vk::Device device, ShaderFeatures declared, Builder &&builder);
+	void destroy();
+
+	/// not thread safe, only the render thread asks for variants once startup is done
+	vk::Pipeline get(ShaderFeatures features) {
+		vk::Pipeline p = pipelines[features & declared];
+		if(!p) {
+			asynclog::logln(litelogger::WARN, "Pipeline variant 0x%x wasn't prebuilt, compiling it while recording", features & declared);
+			p = ensure(features & declared);
+		}
+		return p;
+	}
+	/// bit `key` is set for every variant that was used so far, safe to call from any thread
+	uint32_t builtKeys() const {
+		return built.load();
+	}
+	/// builds every variant in `keys` (bit per key) up front, so recording never has to compile one
+	void prebuild(uint32_t keys);
+	/// exchanges all variants, e.g. with a freshly built set after shaders changed
+	void swap(PipelineVariants &other);
+	/// destroys every variant so they're rebuilt on next use, the caller makes sure none are in flight
+	void clear();
+protected:
+	vk::Pipeline ensure(uint32_t key);
+	vk::Pipeline build(ShaderFeatures features);
+};
+
+#endif //PIPELINEVARIANTS_HPP
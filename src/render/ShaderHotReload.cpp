@@ -0,0 +1,143 @@
+#include "ShaderHotReload.hpp"
+
+#include <util/AsyncLog.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+#include <poll.h>
+#include <spawn.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static bool isShaderSource(const std::string &name) {
+	static const char *EXTENSIONS[] = {".vert", ".frag", ".comp", ".geom", ".tesc", ".tese"};
+	std::string extension = fs::path(name).extension().string();
+	return std::find(std::begin(EXTENSIONS), std::end(EXTENSIONS), extension) != std::end(EXTENSIONS);
+}
+
+bool ShaderHotReload::start(const std::string &directory, const std::string &glslc, Callback &&changed) {
+	this->directory = directory;
+	this->glslc = glslc;
+	this->changed = std::move(changed);
+
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotifyFd < 0)
+		return false;
+	// editors either rewrite the file in place or write a new one and rename it over the old
+	if(inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(inotifyFd);
+		inotifyFd = -1;
+		return false;
+	}
+	stopFd = eventfd(0, EFD_CLOEXEC);
+	if(stopFd < 0) { // without it `stop` couldn't wake the thread up
+		close(inotifyFd);
+		inotifyFd = -1;
+		return false;
+	}
+
+	thread = std::thread(&ShaderHotReload::run, this);
+	asynclog::logln(litelogger::INFO, "Watching %s for shader changes", directory.c_str());
+	return true;
+}
+void ShaderHotReload::stop() {
+	if(inotifyFd < 0)
+		return;
+
+	uint64_t one = 1;
+	if(write(stopFd, &one, sizeof(one)) != sizeof(one))
+		asynclog::logln(litelogger::WARN, "Failed to wake up the shader watcher");
+	thread.join();
+
+	close(stopFd);
+	close(inotifyFd);
+	stopFd = inotifyFd = -1;
+}
+
+void ShaderHotReload::run() {
+	alignas(inotify_event) char buffer[4096];
+	std::set<std::string> dirty;
+
+	while(true) {
+		pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+		// once something changed, wait for the burst to settle before compiling
+		int timeout = dirty.empty() ? -1 : 50;
+		int ready = poll(fds, 2, timeout);
+		if(ready < 0 && errno != EINTR)
+			return;
+		if(fds[1].revents & POLLIN)
+			return;
+
+		if(fds[0].revents & POLLIN) {
+			ssize_t length;
+			while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+				for(char *p = buffer; p < buffer + length;) {
+					const inotify_event *event = reinterpret_cast<const inotify_event*>(p);
+					p += sizeof(inotify_event) + event->len;
+					if(event->len == 0)
+						continue;
+
+					std::string name = event->name;
+					if(isShaderSource(name)) {
+						dirty.insert(name);
+					} else if(fs::path(name).extension() == ".glsl") {
+						// no include graph here, everything might use the header
+						for(const fs::directory_entry &file : fs::directory_iterator(directory))
+							if(isShaderSource(file.path().filename().string()))
+								dirty.insert(file.path().filename().string());
+					}
+				}
+			}
+			continue;
+		}
+		if(ready != 0 || dirty.empty())
+			continue;
+
+		for(const std::string &name : dirty) {
+			std::vector<uint32_t> code;
+			if(!compile(name, code)) {
+				asynclog::logln(litelogger::ERROR, "Failed to recompile %s, keeping the old version :(", name.c_str());
+				continue;
+			}
+			asynclog::logln(litelogger::INFO, "Recompiled %s", name.c_str());
+			changed(name, std::move(code));
+		}
+		dirty.clear();
+	}
+}
+
+bool ShaderHotReload::compile(const std::string &name, std::vector<uint32_t> &code) {
+	std::string source = (fs::path(directory) / name).string();
+	std::string output = (fs::temp_directory_path() / ("vkengine-" + std::to_string(getpid()) + "-" + name + ".spv")).string();
+	// same flags as the cooker, or the reloaded interface might not match the cooked one
+	const char *args[] = {glslc.c_str(), "-O", "-fpreserve-bindings", "-o", output.c_str(), source.c_str(), nullptr};
+
+	pid_t pid;
+	if(posix_spawnp(&pid, glslc.c_str(), nullptr, nullptr, const_cast<char**>(args), environ) != 0) {
+		asynclog::logln(litelogger::ERROR, "Failed to run %s :(", glslc.c_str());
+		return false;
+	}
+	int status;
+	if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return false;
+
+	std::ifstream in(output, std::ios::binary | std::ios::ate);
+	if(!in)
+		return false;
+	size_t size = in.tellg();
+	in.seekg(0);
+	code.resize(size / sizeof(uint32_t));
+	in.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+	bool ok = in.good() && size % sizeof(uint32_t) == 0 && size != 0;
+
+	std::error_code error;
+	fs::remove(output, error);
+	return ok;
+}
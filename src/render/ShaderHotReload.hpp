@@ -0,0 +1,33 @@
+#ifndef SHADERHOTRELOAD_HPP
+#define SHADERHOTRELOAD_HPP
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Development helper: watches a directory of GLSL sources with inotify and recompiles whatever changed with
+/// glslc on its own thread. Saving a shared `.glsl` header recompiles every shader in the directory. Bursts of
+/// events (editors writing a file in several steps) are coalesced before compiling.
+class ShaderHotReload {
+public:
+	/// called on the watcher thread with e.g. "triangle.frag" and its new SPIR-V
+	typedef std::function<void(const std::string &name, std::vector<uint32_t> &&code)> Callback;
+
+	std::string directory;
+	std::string glslc;
+protected:
+	Callback changed;
+	int inotifyFd = -1;
+	int stopFd = -1; // eventfd, wakes the watcher up for `stop`
+	std::thread thread;
+public:
+	/// false if the directory can't be watched
+	bool start(const std::string &directory, const std::string &glslc, Callback &&changed);
+	void stop();
+protected:
+	void run();
+	bool compile(const std::string &name, std::vector<uint32_t> &code);
+};
+
+#endif //SHADERHOTRELOAD_HPP
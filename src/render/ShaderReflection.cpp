@@ -0,0 +1,434 @@
+#include "ShaderReflection.hpp"
+
+#include <algorithm>
+
+// the handful of SPIR-V enums the reflection needs, from the unified SPIR-V spec
+namespace spv {
+	constexpr uint32_t MAGIC = 0x07230203;
+
+	enum Op : uint32_t {
+		OpEntryPoint = 15,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+	enum ExecutionModel : uint32_t {
+		Vertex = 0,
+		TessellationControl = 1,
+		TessellationEvaluation = 2,
+		Geometry = 3,
+		Fragment = 4,
+		GLCompute = 5
+	};
+	enum Decoration : uint32_t {
+		SpecId = 1,
+		Block = 2,
+		BufferBlock = 3,
+		ArrayStride = 6,
+		MatrixStride = 7,
+		BuiltIn = 11,
+		Location = 30,
+		Binding = 33,
+		DescriptorSet = 34,
+		Offset = 35
+	};
+	enum StorageClass : uint32_t {
+		UniformConstant = 0,
+		Input = 1,
+		Uniform = 2,
+		PushConstant = 9,
+		StorageBuffer = 12
+	};
+	enum Dim : uint32_t {
+		DimBuffer = 5,
+		DimSubpassData = 6
+	};
+}
+
+namespace {
+	constexpr uint32_t NONE = UINT32_MAX;
+
+	/// everything the reflection cares about for one result id
+	struct Id {
+		uint32_t opcode = 0;
+		std::vector<uint32_t> operands; // after the result id
+		uint32_t typeId = NONE; // result type of constants and variables
+
+		uint32_t set = NONE, binding = NONE, location = NONE;
+		uint32_t arrayStride = 0;
+		bool builtIn = false, block = false, bufferBlock = false;
+		std::vector<uint32_t> memberOffsets, memberMatrixStrides;
+	};
+
+	struct Module {
+		std::vector<Id> ids;
+
+		const Id *get(uint32_t id) const {
+			return id < ids.size() && ids[id].opcode != 0 ? &ids[id] : nullptr;
+		}
+		uint32_t constant(uint32_t id) const {
+			const Id *c = get(id);
+			return c && c->opcode == spv::OpConstant && !c->operands.empty() ? c->operands[0] : NONE;
+		}
+
+		/// bytes `type` takes up in a block, `matrixStride` comes from the member decoration if it's a matrix
+		uint32_t size(uint32_t type, uint32_t matrixStride = 0, uint32_t depth = 0) const {
+			const Id *t = get(type);
+			if(!t || depth > 32 || t->operands.empty())
+				return 0;
+			switch(t->opcode) {
+				case spv::OpTypeInt:
+				case spv::OpTypeFloat:
+					return t->operands[0] / 8;
+				case spv::OpTypeVector:
+					return t->operands.size() < 2 ? 0 : t->operands[1] * size(t->operands[0], 0, depth + 1);
+				case spv::OpTypeMatrix:
+					if(t->operands.size() < 2)
+						return 0;
+					return t->operands[1] * (matrixStride ? matrixStride : size(t->operands[0], 0, depth + 1));
+				case spv::OpTypeArray: {
+					uint32_t length = t->operands.size() < 2 ? NONE : constant(t->operands[1]);
+					if(length == NONE)
+						return 0;
+					return length * (t->arrayStride ? t->arrayStride : size(t->operands[0], 0, depth + 1));
+				}
+				case spv::OpTypeStruct: {
+					uint32_t end = 0;
+					for(size_t m = 0; m < t->operands.size(); m++) {
+						uint32_t offset = m < t->memberOffsets.size() && t->memberOffsets[m] != NONE ? t->memberOffsets[m] : 0;
+						uint32_t stride = m < t->memberMatrixStrides.size() ? t->memberMatrixStrides[m] : 0;
+						end = std::max(end, offset + size(t->operands[m], stride, depth + 1));
+					}
+					return end;
+				}
+				default:
+					return 0;
+			}
+		}
+
+		vk::Format format(uint32_t type) const {
+			const Id *t = get(type);
+			if(!t || t->operands.empty())
+				return vk::Format::eUndefined;
+
+			uint32_t components = 1;
+			if(t->opcode == spv::OpTypeVector && t->operands.size() >= 2) {
+				components = t->operands[1];
+				t = get(t->operands[0]);
+				if(!t || t->operands.empty())
+					return vk::Format::eUndefined;
+			}
+			if(components < 1 || components > 4)
+				return vk::Format::eUndefined;
+
+			static const vk::Format FLOAT32[] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat};
+			static const vk::Format SINT32[] = {vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint};
+			static const vk::Format UINT32[] = {vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint};
+			static const vk::Format FLOAT64[] = {vk::Format::eR64Sfloat, vk::Format::eR64G64Sfloat, vk::Format::eR64G64B64Sfloat, vk::Format::eR64G64B64A64Sfloat};
+
+			if(t->opcode == spv::OpTypeFloat && t->operands[0] == 32)
+				return FLOAT32[components - 1];
+			if(t->opcode == spv::OpTypeFloat && t->operands[0] == 64)
+				return FLOAT64[components - 1];
+			if(t->opcode == spv::OpTypeInt && t->operands[0] == 32 && t->operands.size() >= 2)
+				return t->operands[1] ? SINT32[components - 1] : UINT32[components - 1];
+			return vk::Format::eUndefined;
+		}
+	};
+}
+
+bool ShaderReflection::reflect(const uint32_t *code, size_t size, std::string &error) {
+	stages = vk::ShaderStageFlags();
+	bindings.clear();
+	pushConstantRanges.clear();
+	vertexInputs.clear();
+	specializationConstants = 0;
+
+	size_t wordCount = size / sizeof(uint32_t);
+	if(size % sizeof(uint32_t) != 0 || wordCount < 5 || code[0] != spv::MAGIC) {
+		error = "not a SPIR-V binary";
+		return false;
+	}
+	uint32_t bound = code[3];
+	if(bound > 4 * 1024 * 1024) {
+		error = "id bound is too large";
+		return false;
+	}
+
+	Module module;
+	module.ids.resize(bound);
+	std::vector<uint32_t> variables;
+
+	for(size_t i = 5; i < wordCount;) {
+		uint32_t length = code[i] >> 16, opcode = code[i] & 0xffff;
+		if(length == 0 || i + length > wordCount) {
+			error = "truncated instruction";
+			return false;
+		}
+		const uint32_t *operands = code + i + 1;
+		uint32_t operandCount = length - 1;
+		i += length;
+
+		auto define = [&](uint32_t result) -> Id* {
+			if(result >= bound)
+				return nullptr;
+			module.ids[result].opcode = opcode;
+			return &module.ids[result];
+		};
+
+		switch(opcode) {
+			case spv::OpEntryPoint: {
+				if(operandCount < 1)
+					break;
+				static const vk::ShaderStageFlagBits STAGES[] = {
+					vk::ShaderStageFlagBits::eVertex, vk::ShaderStageFlagBits::eTessellationControl, vk::ShaderStageFlagBits::eTessellationEvaluation,
+					vk::ShaderStageFlagBits::eGeometry, vk::ShaderStageFlagBits::eFragment, vk::ShaderStageFlagBits::eCompute
+				};
+				if(operands[0] < std::size(STAGES))
+					stages |= STAGES[operands[0]];
+				break;
+			}
+			case spv::OpTypeInt:
+			case spv::OpTypeFloat:
+			case spv::OpTypeVector:
+			case spv::OpTypeMatrix:
+			case spv::OpTypeImage:
+			case spv::OpTypeSampler:
+			case spv::OpTypeSampledImage:
+			case spv::OpTypeArray:
+			case spv::OpTypeRuntimeArray:
+			case spv::OpTypeStruct:
+			case spv::OpTypePointer:
+				if(operandCount >= 1)
+					if(Id *id = define(operands[0]))
+						id->operands.assign(operands + 1, operands + operandCount);
+				break;
+			case spv::OpConstant:
+			case spv::OpVariable:
+				if(operandCount >= 2)
+					if(Id *id = define(operands[1])) {
+						id->typeId = operands[0];
+						id->operands.assign(operands + 2, operands + operandCount);
+						if(opcode == spv::OpVariable)
+							variables.push_back(operands[1]);
+					}
+				break;
+			case spv::OpDecorate: {
+				if(operandCount < 2 || operands[0] >= bound)
+					break;
+				Id &id = module.ids[operands[0]];
+				uint32_t value = operandCount >= 3 ? operands[2] : 0;
+				switch(operands[1]) {
+					case spv::SpecId:
+						if(value < 32)
+							specializationConstants |= 1u << value;
+						break;
+					case spv::Block: id.block = true; break;
+					case spv::BufferBlock: id.bufferBlock = true; break;
+					case spv::ArrayStride: id.arrayStride = value; break;
+					case spv::BuiltIn: id.builtIn = true; break;
+					case spv::Location: id.location = value; break;
+					case spv::Binding: id.binding = value; break;
+					case spv::DescriptorSet: id.set = value; break;
+				}
+				break;
+			}
+			case spv::OpMemberDecorate: {
+				if(operandCount < 4 || operands[0] >= bound || operands[1] > 1024)
+					break;
+				Id &id = module.ids[operands[0]];
+				uint32_t member = operands[1];
+				if(operands[2] == spv::Offset) {
+					id.memberOffsets.resize(std::max<size_t>(id.memberOffsets.size(), member + 1), NONE);
+					id.memberOffsets[member] = operands[3];
+				} else if(operands[2] == spv::MatrixStride) {
+					id.memberMatrixStrides.resize(std::max<size_t>(id.memberMatrixStrides.size(), member + 1), 0);
+					id.memberMatrixStrides[member] = operands[3];
+				} else if(operands[2] == spv::BuiltIn) {
+					id.builtIn = true; // gl_PerVertex members
+				}
+				break;
+			}
+		}
+	}
+
+	for(uint32_t v : variables) {
+		const Id &variable = module.ids[v];
+		const Id *pointer = module.get(variable.typeId);
+		if(!pointer || pointer->opcode != spv::OpTypePointer || pointer->operands.size() < 2 || variable.operands.empty())
+			continue;
+		uint32_t storage = variable.operands[0];
+		uint32_t typeId = pointer->operands[1];
+		const Id *type = module.get(typeId);
+		if(!type)
+			continue;
+
+		if(storage == spv::PushConstant) {
+			uint32_t begin = UINT32_MAX;
+			for(uint32_t offset : type->memberOffsets)
+				if(offset != NONE)
+					begin = std::min(begin, offset);
+			if(begin == UINT32_MAX)
+				begin = 0;
+			uint32_t end = module.size(typeId);
+			if(end > begin)
+				pushConstantRanges.push_back(vk::PushConstantRange(stages, begin, (end - begin + 3) & ~3u));
+			continue;
+		}
+
+		if(storage == spv::Input && (stages & vk::ShaderStageFlagBits::eVertex)) {
+			if(variable.builtIn || type->builtIn || variable.location == NONE)
+				continue;
+
+			// matrices and arrays take one location per column or element
+			uint32_t count = 1, element = typeId;
+			if(type->opcode == spv::OpTypeMatrix && type->operands.size() >= 2) {
+				count = type->operands[1];
+				element = type->operands[0];
+			} else if(type->opcode == spv::OpTypeArray && type->operands.size() >= 2) {
+				count = module.constant(type->operands[1]);
+				element = type->operands[0];
+			}
+			vk::Format format = module.format(element);
+			if(format == vk::Format::eUndefined || count == NONE) {
+				error = "unsupported vertex input type at location " + std::to_string(variable.location);
+				return false;
+			}
+			for(uint32_t c = 0; c < count; c++)
+				vertexInputs.push_back({variable.location + c, format});
+			continue;
+		}
+
+		if(storage != spv::UniformConstant && storage != spv::Uniform && storage != spv::StorageBuffer)
+			continue;
+		if(variable.set == NONE || variable.binding == NONE) {
+			error = "resource without a set or binding decoration";
+			return false;
+		}
+
+		uint32_t count = 1;
+		if(type->opcode == spv::OpTypeRuntimeArray) {
+			error = "unsized descriptor array at set " + std::to_string(variable.set) + " binding " + std::to_string(variable.binding);
+			return false;
+		}
+		if(type->opcode == spv::OpTypeArray && type->operands.size() >= 2) {
+			count = module.constant(type->operands[1]);
+			type = module.get(type->operands[0]);
+			if(!type || count == NONE) {
+				error = "descriptor array without a constant size";
+				return false;
+			}
+		}
+
+		vk::DescriptorType descriptorType;
+		if(storage == spv::StorageBuffer || (storage == spv::Uniform && type->bufferBlock)) {
+			descriptorType = vk::DescriptorType::eStorageBuffer;
+		} else if(storage == spv::Uniform) {
+			descriptorType = vk::DescriptorType::eUniformBuffer;
+		} else if(type->opcode == spv::OpTypeSampler) {
+			descriptorType = vk::DescriptorType::eSampler;
+		} else if(type->opcode == spv::OpTypeSampledImage) {
+			descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		} else if(type->opcode == spv::OpTypeImage && type->operands.size() >= 6) {
+			uint32_t dim = type->operands[1], sampled = type->operands[5];
+			if(dim == spv::DimSubpassData)
+				descriptorType = vk::DescriptorType::eInputAttachment;
+			else if(dim == spv::DimBuffer)
+				descriptorType = sampled == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+			else
+				descriptorType = sampled == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+		} else {
+			continue; // acceleration structures and friends, nothing this engine uses
+		}
+
+		bindings.push_back({variable.set, variable.binding, descriptorType, count, stages});
+	}
+
+	std::sort(bindings.begin(), bindings.end(), [](const Binding &a, const Binding &b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	for(size_t i = 1; i < bindings.size(); i++) {
+		if(bindings[i].set == bindings[i - 1].set && bindings[i].binding == bindings[i - 1].binding) {
+			error = "set " + std::to_string(bindings[i].set) + " binding " + std::to_string(bindings[i].binding) + " is declared twice";
+			return false;
+		}
+	}
+	std::sort(vertexInputs.begin(), vertexInputs.end(), [](const VertexInput &a, const VertexInput &b) {
+		return a.location < b.location;
+	});
+	return true;
+}
+
+bool ShaderReflection::merge(const ShaderReflection &other, std::string &error) {
+	stages |= other.stages;
+	specializationConstants |= other.specializationConstants;
+
+	for(const Binding &b : other.bindings) {
+		auto existing = std::find_if(bindings.begin(), bindings.end(), [&](const Binding &a) {
+			return a.set == b.set && a.binding == b.binding;
+		});
+		if(existing == bindings.end()) {
+			bindings.push_back(b);
+			continue;
+		}
+		if(existing->type != b.type || existing->count != b.count) {
+			error = "stages disagree about set " + std::to_string(b.set) + " binding " + std::to_string(b.binding);
+			return false;
+		}
+		existing->stages |= b.stages;
+	}
+	std::sort(bindings.begin(), bindings.end(), [](const Binding &a, const Binding &b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+
+	for(const vk::PushConstantRange &r : other.pushConstantRanges) {
+		auto existing = std::find_if(pushConstantRanges.begin(), pushConstantRanges.end(), [&](const vk::PushConstantRange &a) {
+			return a.offset == r.offset && a.size == r.size;
+		});
+		if(existing != pushConstantRanges.end())
+			existing->stageFlags |= r.stageFlags;
+		else
+			pushConstantRanges.push_back(r);
+	}
+
+	vertexInputs.insert(vertexInputs.end(), other.vertexInputs.begin(), other.vertexInputs.end());
+	std::sort(vertexInputs.begin(), vertexInputs.end(), [](const VertexInput &a, const VertexInput &b) {
+		return a.location < b.location;
+	});
+	return true;
+}
+
+bool ShaderReflection::sameLayout(const ShaderReflection &other) const {
+	return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(), [](const Binding &a, const Binding &b) {
+		return a.set == b.set && a.binding == b.binding && a.type == b.type && a.count == b.count && a.stages == b.stages;
+	}) && pushConstantRanges == other.pushConstantRanges
+	&& std::equal(vertexInputs.begin(), vertexInputs.end(), other.vertexInputs.begin(), other.vertexInputs.end(), [](const VertexInput &a, const VertexInput &b) {
+		return a.location == b.location && a.format == b.format;
+	});
+}
+std::vector<vk::DescriptorSetLayoutBinding> ShaderReflection::setBindings(uint32_t set) const {
+	std::vector<vk::DescriptorSetLayoutBinding> result;
+	for(const Binding &b : bindings)
+		if(b.set == set)
+			result.push_back(vk::DescriptorSetLayoutBinding(b.binding, b.type, b.count, b.stages, nullptr));
+	return result;
+}
+vk::ShaderStageFlags ShaderReflection::pushConstantStages(uint32_t offset, uint32_t size) const {
+	vk::ShaderStageFlags result;
+	for(const vk::PushConstantRange &r : pushConstantRanges)
+		if(r.offset < offset + size && offset < r.offset + r.size)
+			result |= r.stageFlags;
+	return result;
+}
@@ -0,0 +1,47 @@
+#ifndef SHADERREFLECTION_HPP
+#define SHADERREFLECTION_HPP
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// What a set of SPIR-V modules expects from the pipeline: descriptor bindings, push constants and vertex inputs.
+/// Reflect every stage of a pipeline and `merge` them, bindings shared between stages get exactly the stages
+/// that declare them instead of hand written catch-all flags.
+struct ShaderReflection {
+	struct Binding {
+		uint32_t set, binding;
+		vk::DescriptorType type;
+		uint32_t count;
+		vk::ShaderStageFlags stages;
+	};
+	struct VertexInput {
+		uint32_t location;
+		vk::Format format;
+	};
+
+	vk::ShaderStageFlags stages;
+	std::vector<Binding> bindings; // sorted by set, then binding
+	std::vector<vk::PushConstantRange> pushConstantRanges; // at most one per stage, like Vulkan wants
+	std::vector<VertexInput> vertexInputs; // sorted by location, only from vertex shaders
+	uint32_t specializationConstants; // bit `i` is set if a `constant_id = i` is declared, for ids below 32
+
+	/// parses one module, the `error` describes what's wrong if it returns false
+	bool reflect(const uint32_t *code, size_t size, std::string &error);
+	/// adds another stage's interface, false if both declare the same binding differently
+	bool merge(const ShaderReflection &other, std::string &error);
+
+	/// same descriptor bindings, push constants and vertex inputs, so pipelines built from either share a layout
+	bool sameLayout(const ShaderReflection &other) const;
+
+	uint32_t setCount() const {
+		return bindings.empty() ? 0 : bindings.back().set + 1;
+	}
+	std::vector<vk::DescriptorSetLayoutBinding> setBindings(uint32_t set) const;
+	/// stage flags to pass to `pushConstants` for a range covering `[offset, offset + size)`
+	vk::ShaderStageFlags pushConstantStages(uint32_t offset, uint32_t size) const;
+};
+
+#endif //SHADERREFLECTION_HPP
@@ -0,0 +1,239 @@
+#include "ShadowCascades.hpp"
+
+#include <array>
+#include <bit>
+#include <tuple>
+
+vk::Format ShadowCascades::depthFormat(vk::PhysicalDevice physicalDevice) {
+	vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage
+		| vk::FormatFeatureFlagBits::eTransferSrc | vk::FormatFeatureFlagBits::eTransferDst;
+	for(vk::Format f : {vk::Format::eD32Sfloat, vk::Format::eD16Unorm}) {
+		vk::FormatProperties properties = physicalDevice.getFormatProperties(f);
+		if((properties.optimalTilingFeatures & required) == required)
+			return f;
+	}
+	return vk::Format::eD16Unorm;
+}
+
+void ShadowCascades::create(vk::Device device, vk::PhysicalDevice physicalDevice, vma::Allocator allocator, uint32_t resolution) {
+	this->device = device;
+	this->allocator = allocator;
+	this->resolution = resolution;
+	format = depthFormat(physicalDevice);
+	extent = vk::Extent2D(resolution * 2, resolution * ((cascades::COUNT + 1) / 2));
+
+	vma::AllocationCreateInfo allocationInfo(vma::AllocationCreateFlags(), vma::MemoryUsage::eGpuOnly);
+	std::tie(cacheImage, cacheAllocation) = allocator.createImage(
+		vk::ImageCreateInfo(vk::ImageCreateFlags(),
+			vk::ImageType::e2D, format, vk::Extent3D(extent, 1), 1, 1,
+			vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc
+		),
+		allocationInfo
+	);
+	allocator.setAllocationName(cacheAllocation, "Static shadow cache");
+	std::tie(image, allocation) = allocator.createImage(
+		vk::ImageCreateInfo(vk::ImageCreateFlags(),
+			vk::ImageType::e2D, format, vk::Extent3D(extent, 1), 1, 1,
+			vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled
+		),
+		allocationInfo
+	);
+	allocator.setAllocationName(allocation, "Shadow cascades");
+
+	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1);
+	cacheView = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(), cacheImage, vk::ImageViewType::e2D, format, vk::ComponentMapping(), range));
+	view = device.createImageView(vk::ImageViewCreateInfo(vk::ImageViewCreateFlags(), image, vk::ImageViewType::e2D, format, vk::ComponentMapping(), range));
+
+	// comparisons are filtered after the compare, not every device can do that for every depth format
+	bool linear = static_cast<bool>(physicalDevice.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+	vk::Filter filter = linear ? vk::Filter::eLinear : vk::Filter::eNearest;
+	sampler = device.createSampler(vk::SamplerCreateInfo(vk::SamplerCreateFlags(),
+		filter, filter, vk::SamplerMipmapMode::eNearest,
+		vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+		0.0f, VK_FALSE, 1.0f,
+		VK_TRUE, vk::CompareOp::eLessOrEqual,
+		0.0f, 0.0f, vk::BorderColor::eFloatOpaqueWhite, VK_FALSE
+	));
+
+	// the cache is only ever redrawn or copied out of, previous frames' copies have to be done before it changes
+	cacheRenderPass = createRenderPass(vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eTransferSrcOptimal,
+		vk::SubpassDependency(VK_SUBPASS_EXTERNAL, 0,
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::AccessFlags(), vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite
+		),
+		vk::SubpassDependency(0, VK_SUBPASS_EXTERNAL,
+			vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eTransfer,
+			vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eTransferRead
+		)
+	);
+	compositeRenderPass = createRenderPass(vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+		vk::SubpassDependency(VK_SUBPASS_EXTERNAL, 0,
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite
+		),
+		vk::SubpassDependency(0, VK_SUBPASS_EXTERNAL,
+			vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eFragmentShader,
+			vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead
+		)
+	);
+	cacheFramebuffer = device.createFramebuffer(vk::FramebufferCreateInfo(vk::FramebufferCreateFlags(), cacheRenderPass, 1, &cacheView, extent.width, extent.height, 1));
+	compositeFramebuffer = device.createFramebuffer(vk::FramebufferCreateInfo(vk::FramebufferCreateFlags(), compositeRenderPass, 1, &view, extent.width, extent.height, 1));
+
+	pipeline = nullptr;
+	cacheInitialized = false;
+	refreshes = 0;
+}
+void ShadowCascades::destroy() {
+	if(pipeline)
+		device.destroyPipeline(pipeline);
+	device.destroyFramebuffer(compositeFramebuffer);
+	device.destroyFramebuffer(cacheFramebuffer);
+	device.destroyRenderPass(compositeRenderPass);
+	device.destroyRenderPass(cacheRenderPass);
+	device.destroySampler(sampler);
+	device.destroyImageView(view);
+	device.destroyImageView(cacheView);
+	allocator.destroyImage(image, allocation);
+	allocator.destroyImage(cacheImage, cacheAllocation);
+}
+
+vk::RenderPass ShadowCascades::createRenderPass(vk::ImageLayout initialLayout, vk::ImageLayout finalLayout, const vk::SubpassDependency &before, const vk::SubpassDependency &after) const {
+	vk::AttachmentDescription depthAttachment(vk::AttachmentDescriptionFlags(),
+		format, vk::SampleCountFlagBits::e1,
+		vk::AttachmentLoadOp::eLoad, vk::AttachmentStoreOp::eStore,
+		vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+		initialLayout, finalLayout
+	);
+	vk::AttachmentReference depthReference(0, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+	vk::SubpassDescription subpass(vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics,
+		0, nullptr,
+		0, nullptr, nullptr,
+		&depthReference
+	);
+	std::array<vk::SubpassDependency, 2> dependencies = {before, after};
+	return device.createRenderPass(vk::RenderPassCreateInfo(vk::RenderPassCreateFlags(), 1, &depthAttachment, 1, &subpass, dependencies.size(), dependencies.data()));
+}
+
+void ShadowCascades::createPipeline(vk::ShaderModule vert, vk::PipelineLayout pipelineLayout, const vk::PipelineVertexInputStateCreateInfo &vertexInput, vk::PipelineCache cache) {
+	vk::PipelineShaderStageCreateInfo shaderStage(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, vert, "main");
+	vk::PipelineInputAssemblyStateCreateInfo inputAssembly(vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList, VK_FALSE);
+
+	// every cascade is a different rectangle of the atlas
+	vk::PipelineViewportStateCreateInfo viewportState(vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr);
+	std::array<vk::DynamicState, 2> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+	vk::PipelineDynamicStateCreateInfo dynamicState(vk::PipelineDynamicStateCreateFlags(), dynamicStates.size(), dynamicStates.data());
+
+	// both sides cast, slope scaled bias against acne on surfaces facing away from the sun
+	vk::PipelineRasterizationStateCreateInfo rasterizer(vk::PipelineRasterizationStateCreateFlags(),
+		VK_FALSE, VK_FALSE,
+		vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone, vk::FrontFace::eCounterClockwise,
+		VK_TRUE, 1.25f, 0.0f, 1.75f,
+		1.0f
+	);
+	vk::PipelineMultisampleStateCreateInfo multisampling(vk::PipelineMultisampleStateCreateFlags(), vk::SampleCountFlagBits::e1, VK_FALSE, 1.0f, nullptr, VK_FALSE, VK_FALSE);
+	vk::PipelineDepthStencilStateCreateInfo depthStencil(vk::PipelineDepthStencilStateCreateFlags(), VK_TRUE, VK_TRUE, vk::CompareOp::eLessOrEqual);
+	vk::PipelineColorBlendStateCreateInfo colorBlend(vk::PipelineColorBlendStateCreateFlags(), VK_FALSE, vk::LogicOp::eCopy, 0, nullptr);
+
+	pipeline = device.createGraphicsPipeline(cache, vk::GraphicsPipelineCreateInfo(vk::PipelineCreateFlags(),
+		1, &shaderStage,
+		&vertexInput,
+		&inputAssembly,
+		nullptr, // tesselation
+		&viewportState,
+		&rasterizer,
+		&multisampling,
+		&depthStencil,
+		&colorBlend,
+		&dynamicState,
+		pipelineLayout,
+		cacheRenderPass,
+		0,
+		VK_NULL_HANDLE,
+		-1
+	)).value;
+}
+
+uint32_t ShadowCascades::update(glm::vec3 sunDirection, const glm::mat4 *views, uint32_t viewCount, const glm::mat4 &inverseProjection, float zNear, float distance, bool invalidate) {
+	// a different sun invalidates every cascade's light space
+	if(!cacheInitialized || sunDirection != this->sunDirection) {
+		this->sunDirection = sunDirection;
+		lightView = cascades::lightView(sunDirection);
+		invalidate = true;
+	}
+	cascades::splits(zNear, distance, splits);
+
+	uint32_t mask = 0;
+	for(uint32_t c = 0; c < cascades::COUNT; c++) {
+		cascades::Cascade ideal = cascades::fit(lightView, views, viewCount, inverseProjection, splits[c], splits[c + 1], resolution);
+		if(invalidate || cascades::moved(cached[c], ideal)) {
+			cached[c] = ideal;
+			mask |= 1u << c;
+		}
+	}
+	refreshes += std::popcount(mask);
+	return mask;
+}
+
+void ShadowCascades::setCascadeViewport(vk::CommandBuffer commandBuffer, uint32_t cascade) const {
+	vk::Offset2D offset((cascade % 2) * resolution, (cascade / 2) * resolution);
+	vk::Viewport viewport(offset.x, offset.y, resolution, resolution, 0.0f, 1.0f);
+	vk::Rect2D scissor(offset, vk::Extent2D(resolution, resolution));
+	commandBuffer.setViewport(0, 1, &viewport);
+	commandBuffer.setScissor(0, 1, &scissor);
+}
+
+void ShadowCascades::recordCache(vk::CommandBuffer commandBuffer, uint32_t mask, const std::function<void(uint32_t)> &draw) {
+	if(!cacheInitialized) {
+		// the render pass expects the layout it leaves the cache in, the first refresh covers every cascade
+		vk::ImageMemoryBarrier toTransfer(
+			vk::AccessFlags(), vk::AccessFlags(),
+			vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferSrcOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			cacheImage, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)
+		);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toTransfer);
+		cacheInitialized = true;
+	}
+
+	commandBuffer.beginRenderPass(vk::RenderPassBeginInfo(cacheRenderPass, cacheFramebuffer, vk::Rect2D(vk::Offset2D(), extent), 0, nullptr), vk::SubpassContents::eInline);
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	for(uint32_t c = 0; c < cascades::COUNT; c++) {
+		if(!(mask & (1u << c)))
+			continue;
+		setCascadeViewport(commandBuffer, c);
+
+		vk::ClearAttachment clear(vk::ImageAspectFlagBits::eDepth, 0, vk::ClearDepthStencilValue(1.0f, 0));
+		vk::ClearRect rect(vk::Rect2D(vk::Offset2D((c % 2) * resolution, (c / 2) * resolution), vk::Extent2D(resolution, resolution)), 0, 1);
+		commandBuffer.clearAttachments(1, &clear, 1, &rect);
+
+		draw(c);
+	}
+	commandBuffer.endRenderPass();
+}
+void ShadowCascades::recordComposite(vk::CommandBuffer commandBuffer, const std::function<void(uint32_t)> &draw) const {
+	// the previous frame's lighting has to be done reading before it's overwritten, the old contents don't matter
+	vk::ImageMemoryBarrier toTransfer(
+		vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite,
+		vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)
+	);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+	vk::ImageCopy copy(
+		vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eDepth, 0, 0, 1), vk::Offset3D(),
+		vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eDepth, 0, 0, 1), vk::Offset3D(),
+		vk::Extent3D(extent, 1)
+	);
+	commandBuffer.copyImage(cacheImage, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, 1, &copy);
+
+	commandBuffer.beginRenderPass(vk::RenderPassBeginInfo(compositeRenderPass, compositeFramebuffer, vk::Rect2D(vk::Offset2D(), extent), 0, nullptr), vk::SubpassContents::eInline);
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	for(uint32_t c = 0; c < cascades::COUNT; c++) {
+		setCascadeViewport(commandBuffer, c);
+		draw(c);
+	}
+	commandBuffer.endRenderPass();
+}
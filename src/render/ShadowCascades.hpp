@@ -0,0 +1,66 @@
+#ifndef SHADOWCASCADES_HPP
+#define SHADOWCASCADES_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+
+#include <render/Cascades.hpp>
+
+#include <cstdint>
+#include <functional>
+
+/// Cascaded shadow maps for the sun, all `cascades::COUNT` cascades side by side in one depth atlas.
+///
+/// Static casters go into `cacheImage`, which is only redrawn for the cascades `update` says have moved. Every
+/// frame `recordComposite` copies the cache into `image` and draws the dynamic casters on top of it, so the
+/// per frame cost is one copy plus whatever actually moves. `image` is what the lighting samples.
+class ShadowCascades {
+public:
+	static constexpr uint32_t ALL = (1u << cascades::COUNT) - 1;
+
+	vk::Device device;
+	vma::Allocator allocator;
+	vk::Format format;
+	uint32_t resolution; // of one cascade
+	vk::Extent2D extent; // of the atlas
+
+	vk::Image cacheImage, image;
+	vma::Allocation cacheAllocation, allocation;
+	vk::ImageView cacheView, view;
+	vk::Sampler sampler; // depth comparison, bilinear so it's 2x2 PCF
+
+	// both load what's there, they only differ in layouts, so the same pipeline works in either
+	vk::RenderPass cacheRenderPass, compositeRenderPass;
+	vk::Framebuffer cacheFramebuffer, compositeFramebuffer;
+	vk::Pipeline pipeline;
+
+	glm::mat4 lightView;
+	glm::vec3 sunDirection;
+	cascades::Cascade cached[cascades::COUNT]; // what the atlas currently holds
+	float splits[cascades::COUNT + 1]; // view space depths, refit every frame
+	bool cacheInitialized; // `cacheImage` is still in its initial undefined layout until the first refresh
+	uint64_t refreshes; // cascade redraws so far
+public:
+	/// depth format for the atlases, the device has to render to it, sample it and copy it
+	static vk::Format depthFormat(vk::PhysicalDevice physicalDevice);
+
+	void create(vk::Device device, vk::PhysicalDevice physicalDevice, vma::Allocator allocator, uint32_t resolution);
+	void destroy();
+
+	/// casters only need positions, `pipelineLayout` has to push the world to cascade clip space matrix
+	void createPipeline(vk::ShaderModule vert, vk::PipelineLayout pipelineLayout, const vk::PipelineVertexInputStateCreateInfo &vertexInput, vk::PipelineCache cache);
+
+	/// refits the cascades to the views, returns a mask of the ones that moved far enough to need their static
+	/// casters redrawn. `invalidate` redraws all of them, for when the sun or the static casters changed
+	uint32_t update(glm::vec3 sunDirection, const glm::mat4 *views, uint32_t viewCount, const glm::mat4 &inverseProjection, float zNear, float distance, bool invalidate);
+
+	/// clears and redraws the cascades in `mask` in the cache, `draw` records the static casters of one cascade
+	void recordCache(vk::CommandBuffer commandBuffer, uint32_t mask, const std::function<void(uint32_t)> &draw);
+	/// copies the cache and draws the dynamic casters over it, leaves `image` ready for fragment shaders
+	void recordComposite(vk::CommandBuffer commandBuffer, const std::function<void(uint32_t)> &draw) const;
+protected:
+	void setCascadeViewport(vk::CommandBuffer commandBuffer, uint32_t cascade) const;
+	vk::RenderPass createRenderPass(vk::ImageLayout initialLayout, vk::ImageLayout finalLayout, const vk::SubpassDependency &before, const vk::SubpassDependency &after) const;
+};
+
+#endif //SHADOWCASCADES_HPP
@@ -0,0 +1,261 @@
+#include "SoftwareOcclusion.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <latch>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SOFTWARE_OCCLUSION_AVX2
+#include <immintrin.h>
+#endif
+
+static_assert(SoftwareOcclusion::WIDTH % SoftwareOcclusion::TILE_WIDTH == 0 && SoftwareOcclusion::HEIGHT % SoftwareOcclusion::TILE_HEIGHT == 0, "tiles have to cover the buffer");
+static_assert(SoftwareOcclusion::TILE_WIDTH % 8 == 0, "spans of 8 pixels can't cross tiles");
+
+static void rasterizeScalar(const SoftwareOcclusion::Triangle &t, float *buffer, int32_t minX, int32_t maxX, int32_t minY, int32_t maxY) {
+	for(int32_t y = minY; y <= maxY; y++) {
+		float *row = buffer + y * SoftwareOcclusion::WIDTH;
+		for(int32_t x = minX; x <= maxX; x++) {
+			bool inside = true;
+			for(const glm::vec3 &e : t.edges)
+				inside = inside && e.x * x + e.y * y + e.z >= 0.0f;
+			if(inside)
+				row[x] = std::min(row[x], t.depth.x * x + t.depth.y * y + t.depth.z);
+		}
+	}
+}
+/// true if any pixel in the rectangle is at least as far as `nearest`
+static bool anyBehindScalar(const float *buffer, int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, float nearest) {
+	for(int32_t y = minY; y <= maxY; y++)
+		for(int32_t x = minX; x <= maxX; x++)
+			if(buffer[y * SoftwareOcclusion::WIDTH + x] >= nearest)
+				return true;
+	return false;
+}
+
+#ifdef SOFTWARE_OCCLUSION_AVX2
+/// same as `rasterizeScalar`, 8 pixels of a row at once. `minX` has to be a multiple of 8 and the row has to
+/// have room for whole spans up to `maxX`, pixels outside the triangle are masked off by the edge tests anyway
+__attribute__((target("avx2,fma")))
+static void rasterizeAvx2(const SoftwareOcclusion::Triangle &t, float *buffer, int32_t minX, int32_t maxX, int32_t minY, int32_t maxY) {
+	const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	__m256 a[3], b[3], c[3];
+	for(uint32_t i = 0; i < 3; i++) {
+		a[i] = _mm256_set1_ps(t.edges[i].x);
+		b[i] = _mm256_set1_ps(t.edges[i].y);
+		c[i] = _mm256_set1_ps(t.edges[i].z);
+	}
+	__m256 depthA = _mm256_set1_ps(t.depth.x), depthB = _mm256_set1_ps(t.depth.y), depthC = _mm256_set1_ps(t.depth.z);
+
+	for(int32_t y = minY; y <= maxY; y++) {
+		float *row = buffer + y * SoftwareOcclusion::WIDTH;
+		__m256 fy = _mm256_set1_ps(static_cast<float>(y));
+		__m256 rowEdges[3];
+		for(uint32_t i = 0; i < 3; i++)
+			rowEdges[i] = _mm256_fmadd_ps(b[i], fy, c[i]);
+		__m256 rowDepth = _mm256_fmadd_ps(depthB, fy, depthC);
+
+		for(int32_t x = minX; x <= maxX; x += 8) {
+			__m256 fx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lanes);
+			__m256 inside = _mm256_and_ps(
+				_mm256_and_ps(
+					_mm256_cmp_ps(_mm256_fmadd_ps(a[0], fx, rowEdges[0]), zero, _CMP_GE_OQ),
+					_mm256_cmp_ps(_mm256_fmadd_ps(a[1], fx, rowEdges[1]), zero, _CMP_GE_OQ)
+				),
+				_mm256_cmp_ps(_mm256_fmadd_ps(a[2], fx, rowEdges[2]), zero, _CMP_GE_OQ)
+			);
+			if(_mm256_movemask_ps(inside) == 0)
+				continue;
+
+			__m256 old = _mm256_loadu_ps(row + x);
+			__m256 nearer = _mm256_min_ps(old, _mm256_fmadd_ps(depthA, fx, rowDepth));
+			_mm256_storeu_ps(row + x, _mm256_blendv_ps(old, nearer, inside));
+		}
+	}
+}
+__attribute__((target("avx2")))
+static bool anyBehindAvx2(const float *buffer, int32_t minX, int32_t maxX, int32_t minY, int32_t maxY, float nearest) {
+	__m256 n = _mm256_set1_ps(nearest);
+	for(int32_t y = minY; y <= maxY; y++) {
+		const float *row = buffer + y * SoftwareOcclusion::WIDTH;
+		int32_t x = minX;
+		for(; x + 7 <= maxX; x += 8)
+			if(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(row + x), n, _CMP_GE_OQ)))
+				return true;
+		for(; x <= maxX; x++)
+			if(row[x] >= nearest)
+				return true;
+	}
+	return false;
+}
+#endif
+
+void SoftwareOcclusion::create(uint32_t viewCount, uint32_t threadCount) {
+	this->viewCount = std::min(viewCount, MAX_VIEWS);
+	this->threadCount = threadCount;
+	depth.assign(this->viewCount * WIDTH * HEIGHT, 1.0f);
+
+#ifdef SOFTWARE_OCCLUSION_AVX2
+	avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+	avx2 = false;
+#endif
+
+	if(threadCount > 0)
+		workers.create(threadCount);
+	tested = 0;
+	culled = 0;
+}
+void SoftwareOcclusion::destroy() {
+	if(threadCount > 0)
+		workers.destroy();
+	meshes.clear();
+}
+
+SoftwareOcclusion::MeshHandle SoftwareOcclusion::addMesh(Mesh &&mesh) {
+	meshes.push_back(std::move(mesh));
+	return meshes.size() - 1;
+}
+
+void SoftwareOcclusion::render(const glm::mat4 *viewProjections, float zNear, const std::vector<Occluder> &occluders) {
+	this->zNear = zNear;
+	for(uint32_t v = 0; v < viewCount; v++) {
+		this->viewProjections[v] = viewProjections[v];
+		triangles[v].clear();
+		for(std::vector<uint32_t> &bin : bins[v])
+			bin.clear();
+	}
+
+	// setup and binning are cheap next to filling pixels, they stay on this thread
+	for(const Occluder &o : occluders)
+		for(uint32_t v = 0; v < viewCount; v++)
+			setup(v, viewProjections[v] * o.transform, meshes[o.mesh]);
+
+	uint32_t jobs = viewCount * TILES_X * TILES_Y;
+	if(threadCount == 0) {
+		for(uint32_t j = 0; j < jobs; j++)
+			rasterizeTile(j / (TILES_X * TILES_Y), j % (TILES_X * TILES_Y));
+		return;
+	}
+	// tiles don't share any pixels, so the jobs don't need to synchronize with each other
+	std::latch done(jobs);
+	for(uint32_t j = 0; j < jobs; j++)
+		workers.post([this, j, &done]() {
+			rasterizeTile(j / (TILES_X * TILES_Y), j % (TILES_X * TILES_Y));
+			done.count_down();
+		});
+	done.wait();
+}
+
+void SoftwareOcclusion::setup(uint32_t view, const glm::mat4 &transform, const Mesh &mesh) {
+	for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		glm::vec3 v[3];
+		bool clipped = false;
+		for(uint32_t k = 0; k < 3; k++) {
+			glm::vec4 clip = transform * glm::vec4(mesh.positions[mesh.indices[i + k]], 1.0f);
+			// not clipped against the near plane, leaving such a triangle out only loses some occlusion
+			if(clip.w <= zNear) {
+				clipped = true;
+				break;
+			}
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			v[k] = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z);
+		}
+		if(clipped)
+			continue;
+
+		// both windings are rasterized, the edges are flipped so inside is always positive
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+		if(area < 0.0f) {
+			std::swap(v[1], v[2]);
+			area = -area;
+		}
+		if(area < 1e-6f)
+			continue;
+
+		Triangle t;
+		t.minX = std::max(static_cast<int32_t>(std::floor(std::min({v[0].x, v[1].x, v[2].x}))), 0);
+		t.minY = std::max(static_cast<int32_t>(std::floor(std::min({v[0].y, v[1].y, v[2].y}))), 0);
+		t.maxX = std::min(static_cast<int32_t>(std::ceil(std::max({v[0].x, v[1].x, v[2].x}))) - 1, static_cast<int32_t>(WIDTH) - 1);
+		t.maxY = std::min(static_cast<int32_t>(std::ceil(std::max({v[0].y, v[1].y, v[2].y}))) - 1, static_cast<int32_t>(HEIGHT) - 1);
+		if(t.minX > t.maxX || t.minY > t.maxY)
+			continue;
+
+		// evaluated at a pixel's integer coordinates, the edge functions give their value at the pixel's corner
+		// closest to the outside, so only pixels entirely inside pass
+		for(uint32_t e = 0; e < 3; e++) {
+			glm::vec3 p = v[e], q = v[(e + 1) % 3];
+			float a = p.y - q.y, b = q.x - p.x, c = p.x * q.y - q.x * p.y;
+			t.edges[e] = glm::vec3(a, b, c + 0.5f * (a + b) - 0.5f * (std::abs(a) + std::abs(b)));
+		}
+		// likewise the depth plane gives the farthest depth in the pixel
+		float dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+		float dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+		float c = v[0].z - dzdx * v[0].x - dzdy * v[0].y;
+		t.depth = glm::vec3(dzdx, dzdy, c + 0.5f * (dzdx + dzdy) + 0.5f * (std::abs(dzdx) + std::abs(dzdy)));
+
+		uint32_t index = triangles[view].size();
+		triangles[view].push_back(t);
+		for(int32_t ty = t.minY / TILE_HEIGHT; ty <= t.maxY / static_cast<int32_t>(TILE_HEIGHT); ty++)
+			for(int32_t tx = t.minX / TILE_WIDTH; tx <= t.maxX / static_cast<int32_t>(TILE_WIDTH); tx++)
+				bins[view][ty * TILES_X + tx].push_back(index);
+	}
+}
+
+void SoftwareOcclusion::rasterizeTile(uint32_t view, uint32_t tile) {
+	int32_t tileX = (tile % TILES_X) * TILE_WIDTH, tileY = (tile / TILES_X) * TILE_HEIGHT;
+	float *buffer = depth.data() + view * WIDTH * HEIGHT;
+
+	for(int32_t y = tileY; y < tileY + static_cast<int32_t>(TILE_HEIGHT); y++)
+		std::fill_n(buffer + y * WIDTH + tileX, TILE_WIDTH, 1.0f);
+
+	for(uint32_t index : bins[view][tile]) {
+		const Triangle &t = triangles[view][index];
+		int32_t minX = std::max(t.minX, tileX), maxX = std::min(t.maxX, tileX + static_cast<int32_t>(TILE_WIDTH) - 1);
+		int32_t minY = std::max(t.minY, tileY), maxY = std::min(t.maxY, tileY + static_cast<int32_t>(TILE_HEIGHT) - 1);
+#ifdef SOFTWARE_OCCLUSION_AVX2
+		if(avx2) {
+			rasterizeAvx2(t, buffer, minX & ~7, maxX, minY, maxY);
+			continue;
+		}
+#endif
+		rasterizeScalar(t, buffer, minX, maxX, minY, maxY);
+	}
+}
+
+bool SoftwareOcclusion::visible(glm::vec3 boundsMin, glm::vec3 boundsMax) {
+	tested++;
+	for(uint32_t v = 0; v < viewCount; v++) {
+		glm::vec3 ndcMin(INFINITY), ndcMax(-INFINITY);
+		for(uint32_t i = 0; i < 8; i++) {
+			glm::vec3 corner(i & 1 ? boundsMax.x : boundsMin.x, i & 2 ? boundsMax.y : boundsMin.y, i & 4 ? boundsMax.z : boundsMin.z);
+			glm::vec4 clip = viewProjections[v] * glm::vec4(corner, 1.0f);
+			// crossing the near plane, the projected box would be meaningless
+			if(clip.w <= zNear)
+				return true;
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			ndcMin = glm::min(ndcMin, ndc);
+			ndcMax = glm::max(ndcMax, ndc);
+		}
+		if(ndcMin.x > 1.0f || ndcMin.y > 1.0f || ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.z > 1.0f)
+			continue;
+
+		int32_t minX = std::clamp(static_cast<int32_t>(std::floor((ndcMin.x * 0.5f + 0.5f) * WIDTH)), 0, static_cast<int32_t>(WIDTH) - 1);
+		int32_t minY = std::clamp(static_cast<int32_t>(std::floor((ndcMin.y * 0.5f + 0.5f) * HEIGHT)), 0, static_cast<int32_t>(HEIGHT) - 1);
+		int32_t maxX = std::clamp(static_cast<int32_t>(std::ceil((ndcMax.x * 0.5f + 0.5f) * WIDTH)) - 1, minX, static_cast<int32_t>(WIDTH) - 1);
+		int32_t maxY = std::clamp(static_cast<int32_t>(std::ceil((ndcMax.y * 0.5f + 0.5f) * HEIGHT)) - 1, minY, static_cast<int32_t>(HEIGHT) - 1);
+
+		// hidden only if even its nearest point is behind everything the occluders cover there
+		const float *buffer = viewDepth(v);
+#ifdef SOFTWARE_OCCLUSION_AVX2
+		if(avx2 ? anyBehindAvx2(buffer, minX, maxX, minY, maxY, ndcMin.z) : anyBehindScalar(buffer, minX, maxX, minY, maxY, ndcMin.z))
+			return true;
+#else
+		if(anyBehindScalar(buffer, minX, maxX, minY, maxY, ndcMin.z))
+			return true;
+#endif
+	}
+	culled++;
+	return false;
+}
@@ -0,0 +1,78 @@
+#ifndef SOFTWAREOCCLUSION_HPP
+#define SOFTWAREOCCLUSION_HPP
+
+#include <glm/glm.hpp>
+
+#include <util/ThreadPool.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// Occlusion culling on the CPU, for when the GPU is what's holding the frame back. A handful of occluder meshes
+/// are rasterized into a small depth buffer per view, then bounding boxes are tested against it, so the results
+/// are there for the same frame's draw list without waiting for anything from the GPU.
+///
+/// Depth is Vulkan's, 0 at the near plane and 1 at the far one. Only pixels an occluder covers entirely are
+/// written, with the farthest depth the occluder has in them, so it never hides anything it shouldn't. The
+/// buffer is split into tiles that are rasterized in parallel, eight pixels at a time with AVX2 where the CPU
+/// has it (checked at runtime, the rest of the engine doesn't need it) and one at a time otherwise.
+class SoftwareOcclusion {
+public:
+	static constexpr uint32_t WIDTH = 256, HEIGHT = 128; // per view, stretched over the whole viewport
+	static constexpr uint32_t TILE_WIDTH = 64, TILE_HEIGHT = 32; // one job each, a multiple of 8 wide
+	static constexpr uint32_t TILES_X = WIDTH / TILE_WIDTH, TILES_Y = HEIGHT / TILE_HEIGHT;
+	static constexpr uint32_t MAX_VIEWS = 4;
+
+	typedef uint32_t MeshHandle;
+
+	/// positions only, occluders should be low poly stand ins for the meshes drawn
+	struct Mesh {
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+	};
+	struct Occluder {
+		MeshHandle mesh;
+		glm::mat4 transform;
+	};
+	/// one triangle in buffer space, already set up for rasterizing
+	struct Triangle {
+		glm::vec3 edges[3]; // `a * x + b * y + c`, at least 0 for pixels entirely inside
+		glm::vec3 depth; // plane through the vertices, `a * x + b * y + c`, already moved to the farthest point of a pixel
+		int32_t minX, minY, maxX, maxY; // pixels touched, inclusive
+	};
+
+	std::vector<Mesh> meshes;
+
+	uint32_t viewCount;
+	std::vector<float> depth; // `WIDTH * HEIGHT` per view, row major
+	std::vector<Triangle> triangles[MAX_VIEWS]; // per view, rebuilt by every `render`
+	std::vector<uint32_t> bins[MAX_VIEWS][TILES_X * TILES_Y]; // indices into `triangles` per tile
+	bool avx2;
+
+	ThreadPool workers; // none with `threadCount == 0`, then tiles are rasterized on the calling thread
+	uint32_t threadCount;
+
+	glm::mat4 viewProjections[MAX_VIEWS];
+	float zNear;
+
+	uint64_t tested, culled; // boxes so far
+public:
+	void create(uint32_t viewCount, uint32_t threadCount);
+	void destroy();
+
+	MeshHandle addMesh(Mesh &&mesh);
+
+	/// clears the depth buffers and rasterizes `occluders` into every view, blocks until all tiles are done
+	void render(const glm::mat4 *viewProjections, float zNear, const std::vector<Occluder> &occluders);
+	/// false if the box is hidden behind the occluders or outside of every view
+	bool visible(glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+	const float *viewDepth(uint32_t view) const {
+		return depth.data() + view * WIDTH * HEIGHT;
+	}
+protected:
+	void setup(uint32_t view, const glm::mat4 &transform, const Mesh &mesh);
+	void rasterizeTile(uint32_t view, uint32_t tile);
+};
+
+#endif //SOFTWAREOCCLUSION_HPP
@@ -0,0 +1,135 @@
+#include "Validation.hpp"
+
+#include <util/Config.hpp>
+
+#include <cstring>
+
+Validation::Tier Validation::tierFromConfig() {
+#ifdef NDEBUG
+	const char *tier = config::get("VKENGINE_VALIDATION", "off");
+#else
+	const char *tier = config::get("VKENGINE_VALIDATION", "core");
+#endif
+	if(strcmp(tier, "full") == 0)
+		return FULL;
+	if(strcmp(tier, "core") == 0)
+		return CORE;
+	return OFF;
+}
+
+void Validation::configure(Tier tier, const litelogger::Logger &logger, std::vector<const char *> &layers, std::vector<const char *> &instanceExtensions) {
+	this->tier = tier;
+	this->logger = &logger;
+	windowStart = std::chrono::steady_clock::now();
+	windowCount = 0;
+	suppressed = 0;
+
+	if(tier == OFF)
+		return;
+
+	bool layerFound = false;
+	for(const vk::LayerProperties &l : vk::enumerateInstanceLayerProperties())
+		if(strcmp(l.layerName, "VK_LAYER_KHRONOS_validation") == 0)
+			layerFound = true;
+	if(!layerFound) {
+		asynclog::logln(litelogger::WARN, "Validation tier \"%s\" requested but VK_LAYER_KHRONOS_validation isn't installed, turning validation off", TIER_NAMES[tier]);
+		this->tier = OFF;
+		return;
+	}
+
+	layers.push_back("VK_LAYER_KHRONOS_validation");
+	instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
+	messengerCreateInfo = {};
+	messengerCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	messengerCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	messengerCreateInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+	messengerCreateInfo.pfnUserCallback = callback;
+	messengerCreateInfo.pUserData = this;
+
+	if(tier == FULL) {
+		instanceExtensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+
+		enabledFeatures = {
+			VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT,
+			VK_VALIDATION_FEATURE_ENABLE_BEST_PRACTICES_EXT
+		};
+		validationFeatures = {};
+		validationFeatures.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+		validationFeatures.pNext = &messengerCreateInfo;
+		validationFeatures.enabledValidationFeatureCount = enabledFeatures.size();
+		validationFeatures.pEnabledValidationFeatures = enabledFeatures.data();
+	}
+
+	asynclog::logln(*this->logger, "Validation tier: %s", TIER_NAMES[tier]);
+}
+const void *Validation::instancePNext() const {
+	switch(tier) {
+		case OFF:
+			return nullptr;
+		case CORE:
+			return &messengerCreateInfo;
+		case FULL:
+			return &validationFeatures;
+	}
+	return nullptr;
+}
+
+void Validation::createMessenger(vk::Instance instance) {
+	if(tier == OFF)
+		return;
+
+	VkDebugUtilsMessengerEXT m;
+	if(VULKAN_HPP_DEFAULT_DISPATCHER.vkCreateDebugUtilsMessengerEXT(instance, &messengerCreateInfo, nullptr, &m) != VK_SUCCESS)
+		asynclog::exitError("Failed to create debug messenger :(");
+	messenger = m;
+}
+void Validation::destroy(vk::Instance instance) {
+	if(tier == OFF)
+		return;
+
+	VULKAN_HPP_DEFAULT_DISPATCHER.vkDestroyDebugUtilsMessengerEXT(instance, messenger, nullptr);
+	if(suppressed > 0)
+		asynclog::logln(*logger, "%llu validation messages were suppressed", (unsigned long long) suppressed);
+}
+
+void Validation::message(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT *data) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// the same problem tends to be reported every frame, only print it a few times
+	uint32_t &count = repeats[data->messageIdNumber];
+	if(++count > MAX_REPEATS) {
+		suppressed++;
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if(now - windowStart > std::chrono::seconds(1)) {
+		windowStart = now;
+		windowCount = 0;
+	}
+	if(++windowCount > MAX_PER_SECOND) {
+		suppressed++;
+		return;
+	}
+
+	const char *severityName = severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT ? "error" : "warning";
+	const char *typeName = type & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT ? "performance" :
+		type & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT ? "validation" : "general";
+
+	asynclog::logln(*logger, "%s %s [%s]%s: %s",
+		typeName, severityName,
+		data->pMessageIdName ? data->pMessageIdName : "?",
+		count == MAX_REPEATS ? " (muting further repeats)" : "",
+		data->pMessage
+	);
+}
+VKAPI_ATTR VkBool32 VKAPI_CALL Validation::callback(
+	VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+	VkDebugUtilsMessageTypeFlagsEXT type,
+	const VkDebugUtilsMessengerCallbackDataEXT *data,
+	void *userData
+) {
+	static_cast<Validation*>(userData)->message(severity, type, data);
+	return VK_FALSE;
+}
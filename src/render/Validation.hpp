@@ -0,0 +1,61 @@
+#ifndef VALIDATION_HPP
+#define VALIDATION_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <util/AsyncLog.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/// Validation layer setup and a `VK_EXT_debug_utils` messenger forwarding to a logger.
+/// The tier comes from `VKENGINE_VALIDATION=off|core|full`, defaulting to `off` in release builds
+/// and `core` otherwise. With `off` no layer, extension or messenger is created at all.
+class Validation {
+public:
+	enum Tier : uint8_t {
+		OFF,
+		CORE, // Khronos validation layer
+		FULL // + synchronization validation and best practices
+	};
+	static constexpr const char *TIER_NAMES[] = {"off", "core", "full"};
+
+	static constexpr uint32_t MAX_REPEATS = 5; // identical messages printed before they are muted
+	static constexpr uint32_t MAX_PER_SECOND = 50;
+
+	Tier tier;
+	const litelogger::Logger *logger;
+
+	VkDebugUtilsMessengerCreateInfoEXT messengerCreateInfo;
+	VkValidationFeaturesEXT validationFeatures;
+	std::vector<VkValidationFeatureEnableEXT> enabledFeatures;
+	vk::DebugUtilsMessengerEXT messenger;
+protected:
+	std::mutex mutex; // the driver may call back from any thread
+	std::unordered_map<int32_t, uint32_t> repeats;
+	std::chrono::steady_clock::time_point windowStart;
+	uint32_t windowCount;
+	uint64_t suppressed;
+public:
+	static Tier tierFromConfig();
+
+	/// appends whatever `tier` needs to `layers` and `instanceExtensions`, may lower `tier`
+	/// if the layer isn't installed
+	void configure(Tier tier, const litelogger::Logger &logger, std::vector<const char *> &layers, std::vector<const char *> &instanceExtensions);
+	/// chain into `vk::InstanceCreateInfo::pNext` so instance creation is validated too
+	const void *instancePNext() const;
+
+	void createMessenger(vk::Instance instance);
+	void destroy(vk::Instance instance);
+protected:
+	void message(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT *data);
+	static VKAPI_ATTR VkBool32 VKAPI_CALL callback(
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT type,
+		const VkDebugUtilsMessengerCallbackDataEXT *data,
+		void *userData
+	);
+};
+
+#endif //VALIDATION_HPP
@@ -0,0 +1,427 @@
+#include <asset/CookedFormats.hpp>
+#include <litelogger.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+/// Turns source assets into what the engine loads at runtime: `AssetCooker <source> <output> [glslc]`.
+///
+///  - GLSL (`.vert`, `.frag`, `.comp`, ...) is compiled to `<name>.spv` with glslc
+///  - images are decoded to `.tex` (`cooked::TextureHeader` + RGBA8)
+///  - Wavefront `.obj` meshes are indexed into `.mesh` (`cooked::MeshHeader` + vertices + indices)
+///  - `.glsl` headers are skipped, they only end up in the keys of shaders including them
+///  - everything else is copied as is
+///
+/// Every output is keyed by a hash of its inputs (the source, anything it `#include`s), the converter's version
+/// and the external tool's version. Keys live in `<output>.cache`; outputs whose key didn't change are skipped,
+/// the rest are cooked in parallel. Outputs whose source disappeared are removed.
+static constexpr uint32_t COOKER_VERSION = 1;
+
+static uint64_t hash(const void *data, size_t size, uint64_t h = 0xcbf29ce484222325ull) {
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+	for(size_t i = 0; i < size; i++)
+		h = (h ^ bytes[i]) * 0x100000001b3ull;
+	return h;
+}
+static uint64_t hash(const std::string &s, uint64_t h) {
+	return hash(s.data(), s.size() + 1, h); // with the terminator so concatenated strings don't collide
+}
+
+static bool readFile(const fs::path &path, std::vector<uint8_t> &contents) {
+	std::ifstream in(path, std::ios::binary);
+	if(!in)
+		return false;
+	contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return in.good() || in.eof();
+}
+static bool writeFile(const fs::path &path, const void *data, size_t size) {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(static_cast<const char*>(data), size);
+	return out.good();
+}
+
+struct Job;
+struct Converter {
+	const char *name;
+	uint32_t version; // bump to recook everything this converter produced
+	std::vector<std::string> extensions;
+	std::string (*outputName)(const std::string &sourceName);
+	/// writes the cooked asset to `output`
+	bool (*cook)(const Job &job, const fs::path &output);
+	/// files besides the source that the output depends on
+	void (*dependencies)(const fs::path &source, const std::vector<uint8_t> &contents, std::set<fs::path> &out);
+};
+
+struct Job {
+	fs::path source;
+	std::string sourceName, outputName;
+	const Converter *converter;
+	std::vector<uint8_t> contents;
+	uint64_t key;
+};
+
+static std::string glslc = "glslc";
+static std::string glslcVersion; // part of every shader's key
+
+static std::string appendExtension(const std::string &name, const char *extension) {
+	return name + extension;
+}
+static std::string replaceExtension(const std::string &name, const char *extension) {
+	return fs::path(name).replace_extension(extension).generic_string();
+}
+
+static void shaderDependencies(const fs::path &source, const std::vector<uint8_t> &contents, std::set<fs::path> &out) {
+	std::istringstream lines(std::string(contents.begin(), contents.end()));
+	for(std::string line; std::getline(lines, line);) {
+		size_t directive = line.find("#include");
+		if(directive == std::string::npos)
+			continue;
+		size_t open = line.find('"', directive), close = line.find('"', open + 1);
+		if(open == std::string::npos || close == std::string::npos)
+			continue;
+
+		fs::path include = (source.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal();
+		std::vector<uint8_t> included;
+		if(out.insert(include).second && readFile(include, included))
+			shaderDependencies(include, included, out);
+	}
+}
+static bool cookShader(const Job &job, const fs::path &output) {
+	std::string outputPath = output.string(), sourcePath = job.source.string();
+	// the engine reflects its layouts from these, unused bindings have to survive the optimizer
+	const char *args[] = {glslc.c_str(), "-O", "-fpreserve-bindings", "-o", outputPath.c_str(), sourcePath.c_str(), nullptr};
+
+	pid_t pid;
+	if(posix_spawnp(&pid, glslc.c_str(), nullptr, nullptr, const_cast<char**>(args), environ) != 0) {
+		litelogger::logln(litelogger::ERROR, "Failed to run %s :(", glslc.c_str());
+		return false;
+	}
+	int status;
+	if(waitpid(pid, &status, 0) != pid)
+		return false;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool cookTexture(const Job &job, const fs::path &output) {
+	int width, height, channels;
+	stbi_uc *texels = stbi_load_from_memory(job.contents.data(), job.contents.size(), &width, &height, &channels, 4);
+	if(!texels) {
+		litelogger::logln(litelogger::ERROR, "%s: %s :(", job.sourceName.c_str(), stbi_failure_reason());
+		return false;
+	}
+
+	cooked::TextureHeader header = {};
+	memcpy(header.magic, cooked::TextureHeader::MAGIC, sizeof(header.magic));
+	header.version = cooked::TextureHeader::VERSION;
+	header.width = width;
+	header.height = height;
+
+	std::vector<uint8_t> blob(sizeof(header) + (size_t) width * height * 4);
+	memcpy(blob.data(), &header, sizeof(header));
+	memcpy(blob.data() + sizeof(header), texels, blob.size() - sizeof(header));
+	stbi_image_free(texels);
+
+	return writeFile(output, blob.data(), blob.size());
+}
+
+static bool cookMesh(const Job &job, const fs::path &output) {
+	std::vector<float> positions, normals, uvs;
+	std::vector<cooked::MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::map<std::tuple<int, int, int>, uint32_t> unique; // position/uv/normal triple -> vertex
+
+	// obj indices are 1 based, negative ones count back from the last element read so far
+	auto resolve = [](const std::string &s, size_t count) -> int {
+		if(s.empty())
+			return -1;
+		int i = std::stoi(s);
+		return i < 0 ? (int) count + i : i - 1;
+	};
+
+	std::istringstream lines(std::string(job.contents.begin(), job.contents.end()));
+	uint32_t lineNumber = 0;
+	for(std::string line; std::getline(lines, line);) {
+		lineNumber++;
+		std::istringstream tokens(line);
+		std::string type;
+		tokens >> type;
+
+		if(type == "v" || type == "vn" || type == "vt") {
+			std::vector<float> &target = type == "v" ? positions : type == "vn" ? normals : uvs;
+			uint32_t components = type == "vt" ? 2 : 3;
+			for(uint32_t c = 0; c < components; c++) {
+				float f = 0;
+				tokens >> f;
+				target.push_back(f);
+			}
+		} else if(type == "f") {
+			std::vector<uint32_t> polygon;
+			for(std::string corner; tokens >> corner;) {
+				std::string parts[3];
+				for(size_t start = 0, p = 0; p < 3; p++) {
+					size_t slash = corner.find('/', start);
+					parts[p] = corner.substr(start, slash - start);
+					if(slash == std::string::npos)
+						break;
+					start = slash + 1;
+				}
+
+				std::tuple<int, int, int> key;
+				try {
+					key = {resolve(parts[0], positions.size() / 3), resolve(parts[1], uvs.size() / 2), resolve(parts[2], normals.size() / 3)};
+				} catch(const std::exception&) {
+					litelogger::logln(litelogger::ERROR, "%s:%u: bad face %s :(", job.sourceName.c_str(), lineNumber, corner.c_str());
+					return false;
+				}
+				auto [p, t, n] = key;
+				if(p < 0 || (size_t) p >= positions.size() / 3 || (t >= 0 && (size_t) t >= uvs.size() / 2) || (n >= 0 && (size_t) n >= normals.size() / 3)) {
+					litelogger::logln(litelogger::ERROR, "%s:%u: index out of range :(", job.sourceName.c_str(), lineNumber);
+					return false;
+				}
+
+				auto found = unique.find(key);
+				if(found == unique.end()) {
+					cooked::MeshVertex v = {};
+					memcpy(v.position, &positions[p * 3], sizeof(v.position));
+					if(t >= 0) {
+						v.uv[0] = uvs[t * 2];
+						v.uv[1] = 1.0f - uvs[t * 2 + 1]; // obj has v pointing up, Vulkan samples top down
+					}
+					if(n >= 0)
+						memcpy(v.normal, &normals[n * 3], sizeof(v.normal));
+					found = unique.emplace(key, vertices.size()).first;
+					vertices.push_back(v);
+				}
+				polygon.push_back(found->second);
+			}
+			// fan triangulation, fine for the convex polygons exporters write
+			for(size_t i = 2; i < polygon.size(); i++)
+				indices.insert(indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+		}
+	}
+
+	// meshes exported without normals get smooth ones, area weighted
+	if(normals.empty()) {
+		for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const float *a = vertices[indices[i]].position, *b = vertices[indices[i + 1]].position, *c = vertices[indices[i + 2]].position;
+			float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]}, e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+			float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+			for(size_t j = 0; j < 3; j++)
+				for(size_t k = 0; k < 3; k++)
+					vertices[indices[i + j]].normal[k] += n[k];
+		}
+		for(cooked::MeshVertex &v : vertices) {
+			float length = std::sqrt(v.normal[0] * v.normal[0] + v.normal[1] * v.normal[1] + v.normal[2] * v.normal[2]);
+			if(length > 0)
+				for(float &f : v.normal)
+					f /= length;
+		}
+	}
+
+	cooked::MeshHeader header = {};
+	memcpy(header.magic, cooked::MeshHeader::MAGIC, sizeof(header.magic));
+	header.version = cooked::MeshHeader::VERSION;
+	header.vertexCount = vertices.size();
+	header.indexCount = indices.size();
+
+	std::ofstream out(output, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(cooked::MeshVertex));
+	out.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+	return out.good();
+}
+
+static bool copy(const Job &job, const fs::path &output) {
+	return writeFile(output, job.contents.data(), job.contents.size());
+}
+
+static const Converter CONVERTERS[] = {
+	{"shader", 2, {".vert", ".frag", ".comp", ".geom", ".tesc", ".tese"}, [](const std::string &name) { return appendExtension(name, ".spv"); }, cookShader, shaderDependencies},
+	{"texture", cooked::TextureHeader::VERSION, {".png", ".jpg", ".jpeg", ".tga", ".bmp", ".hdr"}, [](const std::string &name) { return replaceExtension(name, ".tex"); }, cookTexture, nullptr},
+	{"mesh", cooked::MeshHeader::VERSION, {".obj"}, [](const std::string &name) { return replaceExtension(name, ".mesh"); }, cookMesh, nullptr},
+	{"copy", 1, {}, [](const std::string &name) { return name; }, copy, nullptr}
+};
+
+static const Converter &converterFor(const fs::path &source) {
+	std::string extension = source.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	for(const Converter &c : CONVERTERS)
+		if(std::find(c.extensions.begin(), c.extensions.end(), extension) != c.extensions.end())
+			return c;
+	return CONVERTERS[std::size(CONVERTERS) - 1];
+}
+
+static std::string queryGlslcVersion() {
+	std::string command = "\"" + glslc + "\" --version 2>/dev/null";
+	FILE *pipe = popen(command.c_str(), "r");
+	if(!pipe)
+		return "";
+	std::string version;
+	char buffer[256];
+	for(size_t n; (n = fread(buffer, 1, sizeof(buffer), pipe)) > 0;)
+		version.append(buffer, n);
+	pclose(pipe);
+	return version;
+}
+
+int main(int argc, char **argv) {
+	if(argc != 3 && argc != 4) {
+		litelogger::logln(litelogger::ERROR, "Usage: %s <source> <output> [glslc]", argv[0]);
+		return EXIT_FAILURE;
+	}
+	fs::path sourceRoot = argv[1], outputRoot = argv[2];
+	fs::path cachePath = outputRoot.string() + ".cache";
+	if(argc == 4)
+		glslc = argv[3];
+
+	std::map<std::string, uint64_t> cache; // output name -> key it was cooked with
+	{
+		std::ifstream in(cachePath);
+		std::string name;
+		uint64_t key;
+		while(in >> std::hex >> key && std::getline(in >> std::ws, name))
+			cache[name] = key;
+	}
+
+	std::vector<Job> jobs;
+	std::map<std::string, std::string> outputs; // output name -> source name, to catch two sources cooking to the same file
+	bool ok = true;
+	for(const fs::directory_entry &file : fs::recursive_directory_iterator(sourceRoot)) {
+		// shared GLSL only matters through the shaders including it
+		if(!file.is_regular_file() || file.path().extension() == ".glsl")
+			continue;
+
+		Job job;
+		job.source = file.path();
+		job.sourceName = file.path().lexically_relative(sourceRoot).generic_string();
+		job.converter = &converterFor(job.source);
+		job.outputName = job.converter->outputName(job.sourceName);
+		job.key = 0;
+
+		auto [existing, inserted] = outputs.emplace(job.outputName, job.sourceName);
+		if(!inserted) {
+			litelogger::logln(litelogger::ERROR, "%s and %s both cook to %s :(", existing->second.c_str(), job.sourceName.c_str(), job.outputName.c_str());
+			ok = false;
+			continue;
+		}
+		jobs.push_back(std::move(job));
+	}
+	if(!ok)
+		return EXIT_FAILURE;
+
+	std::atomic<size_t> next{0};
+	std::atomic<uint32_t> cooked{0}, failed{0};
+	auto work = [&]() {
+		for(size_t i; (i = next.fetch_add(1)) < jobs.size();) {
+			Job &job = jobs[i];
+			if(!readFile(job.source, job.contents)) {
+				litelogger::logln(litelogger::ERROR, "Failed to read %s :(", job.sourceName.c_str());
+				failed++;
+				continue;
+			}
+
+			uint64_t key = hash(&COOKER_VERSION, sizeof(COOKER_VERSION));
+			key = hash(std::string(job.converter->name), key);
+			key = hash(&job.converter->version, sizeof(job.converter->version), key);
+			if(job.converter->cook == cookShader)
+				key = hash(glslcVersion, key);
+			key = hash(job.contents.data(), job.contents.size(), key);
+			if(job.converter->dependencies) {
+				std::set<fs::path> dependencies;
+				job.converter->dependencies(job.source, job.contents, dependencies);
+				for(const fs::path &d : dependencies) {
+					std::vector<uint8_t> contents;
+					readFile(d, contents); // a missing include still changes the key once it shows up
+					key = hash(d.generic_string(), key);
+					key = hash(contents.data(), contents.size(), key);
+				}
+			}
+			job.key = key;
+
+			fs::path output = outputRoot / job.outputName;
+			auto cached = cache.find(job.outputName);
+			if(cached != cache.end() && cached->second == key && fs::exists(output))
+				continue;
+
+			// cook next to the output and rename, so an interrupted run never leaves a half written file behind
+			fs::path temporary = output.string() + ".tmp";
+			std::error_code error;
+			fs::create_directories(output.parent_path(), error);
+			if(!job.converter->cook(job, temporary)) {
+				litelogger::logln(litelogger::ERROR, "Failed to cook %s :(", job.sourceName.c_str());
+				fs::remove(temporary, error);
+				job.key = 0;
+				failed++;
+				continue;
+			}
+			fs::rename(temporary, output, error);
+			if(error) {
+				litelogger::logln(litelogger::ERROR, "Failed to write %s :(", job.outputName.c_str());
+				job.key = 0;
+				failed++;
+				continue;
+			}
+			litelogger::logln(litelogger::INFO, "Cooked %s (%s)", job.outputName.c_str(), job.converter->name);
+			cooked++;
+		}
+	};
+
+	bool needsGlslc = std::any_of(jobs.begin(), jobs.end(), [](const Job &job) {
+		return job.converter->cook == cookShader;
+	});
+	if(needsGlslc)
+		glslcVersion = queryGlslcVersion();
+
+	uint32_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), std::max<size_t>(jobs.size(), 1));
+	std::vector<std::thread> threads;
+	for(uint32_t i = 1; i < threadCount; i++)
+		threads.emplace_back(work);
+	work();
+	for(std::thread &t : threads)
+		t.join();
+
+	// anything cooked earlier whose source is gone
+	uint32_t removed = 0;
+	for(const auto &[name, key] : cache) {
+		if(outputs.count(name))
+			continue;
+		std::error_code error;
+		if(fs::remove(outputRoot / name, error))
+			removed++;
+	}
+
+	// failed jobs are left out so they're retried next time
+	std::ofstream out(cachePath, std::ios::trunc);
+	for(const Job &job : jobs)
+		if(job.key != 0)
+			out << std::hex << job.key << ' ' << job.outputName << '\n';
+
+	litelogger::logln(litelogger::INFO, "Cooked %u of %zu assets, %zu up to date, %u removed", cooked.load(), jobs.size(),
+		jobs.size() - cooked - failed, removed
+	);
+	if(failed != 0) {
+		litelogger::logln(litelogger::ERROR, "%u assets failed to cook :(", failed.load());
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include <asset/AssetPack.hpp>
+#include <util/Lz4.hpp>
+#include <litelogger.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/// Builds an `AssetPack` out of a directory: `AssetPacker <directory> <output>`.
+/// Entries are compressed when that saves at least an eighth of their size, except for SPIR-V which
+/// the engine passes straight from the mapping to Vulkan.
+struct PackedEntry {
+	std::string name;
+	AssetPack::Entry entry;
+	std::vector<uint8_t> blob;
+};
+
+static bool storeUncompressed(const std::string &name) {
+	return name.size() >= 4 && name.compare(name.size() - 4, 4, ".spv") == 0;
+}
+
+static std::vector<uint8_t> compress(const std::vector<uint8_t> &contents, uint32_t &chunkCount) {
+	chunkCount = (contents.size() + AssetPack::CHUNK_SIZE - 1) / AssetPack::CHUNK_SIZE;
+
+	std::vector<uint8_t> blob(chunkCount * sizeof(uint32_t));
+	std::vector<uint8_t> chunk(lz4::compressBound(AssetPack::CHUNK_SIZE));
+	for(uint32_t c = 0; c < chunkCount; c++) {
+		size_t offset = (size_t) c * AssetPack::CHUNK_SIZE;
+		size_t size = std::min<size_t>(AssetPack::CHUNK_SIZE, contents.size() - offset);
+
+		uint32_t compressedSize = lz4::compress(contents.data() + offset, size, chunk.data());
+		memcpy(blob.data() + c * sizeof(uint32_t), &compressedSize, sizeof(uint32_t));
+		blob.insert(blob.end(), chunk.begin(), chunk.begin() + compressedSize);
+	}
+	return blob;
+}
+
+int main(int argc, char **argv) {
+	if(argc != 3) {
+		litelogger::logln(litelogger::ERROR, "Usage: %s <directory> <output>", argv[0]);
+		return EXIT_FAILURE;
+	}
+	fs::path root = argv[1];
+
+	std::vector<PackedEntry> packed;
+	for(const fs::directory_entry &file : fs::recursive_directory_iterator(root)) {
+		if(!file.is_regular_file())
+			continue;
+
+		PackedEntry p;
+		p.name = file.path().lexically_relative(root).generic_string();
+
+		std::ifstream in(file.path(), std::ios::binary);
+		std::vector<uint8_t> contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		if(!in.good() && !in.eof()) {
+			litelogger::logln(litelogger::ERROR, "Failed to read %s :(", file.path().c_str());
+			return EXIT_FAILURE;
+		}
+
+		p.entry = {};
+		p.entry.hash = AssetPack::hash(p.name.c_str());
+		p.entry.size = contents.size();
+
+		uint32_t chunkCount = 0;
+		std::vector<uint8_t> compressed;
+		if(!storeUncompressed(p.name) && !contents.empty())
+			compressed = compress(contents, chunkCount);
+
+		if(chunkCount != 0 && compressed.size() <= contents.size() - contents.size() / 8) {
+			p.entry.chunkCount = chunkCount;
+			p.blob = std::move(compressed);
+		} else {
+			p.blob = std::move(contents);
+		}
+		p.entry.storedSize = p.blob.size();
+
+		packed.push_back(std::move(p));
+	}
+	std::sort(packed.begin(), packed.end(), [](const PackedEntry &a, const PackedEntry &b) {
+		return a.entry.hash < b.entry.hash;
+	});
+
+	AssetPack::Header header = {};
+	memcpy(header.magic, AssetPack::MAGIC, sizeof(header.magic));
+	header.version = AssetPack::VERSION;
+	header.entryCount = packed.size();
+
+	auto align = [](uint64_t offset) {
+		return (offset + AssetPack::ALIGNMENT - 1) & ~(AssetPack::ALIGNMENT - 1);
+	};
+
+	uint64_t offset = align(sizeof(AssetPack::Header));
+	std::string names;
+	for(PackedEntry &p : packed) {
+		p.entry.offset = offset;
+		p.entry.nameOffset = names.size();
+		names.append(p.name);
+		names.push_back('\0');
+		offset = align(offset + p.blob.size());
+	}
+	header.indexOffset = offset;
+	header.namesOffset = offset + packed.size() * sizeof(AssetPack::Entry);
+	header.namesSize = names.size() + 1; // an empty pack still has a terminated name table
+	names.push_back('\0');
+
+	std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+	auto pad = [&](uint64_t to) {
+		static const char zeros[AssetPack::ALIGNMENT] = {};
+		out.write(zeros, to - out.tellp());
+	};
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for(const PackedEntry &p : packed) {
+		pad(p.entry.offset);
+		out.write(reinterpret_cast<const char*>(p.blob.data()), p.blob.size());
+	}
+	pad(header.indexOffset);
+	for(const PackedEntry &p : packed)
+		out.write(reinterpret_cast<const char*>(&p.entry), sizeof(p.entry));
+	out.write(names.data(), names.size());
+
+	if(!out.good()) {
+		litelogger::logln(litelogger::ERROR, "Failed to write %s :(", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	uint64_t storedSize = 0, size = 0;
+	for(const PackedEntry &p : packed) {
+		size += p.entry.size;
+		storedSize += p.entry.storedSize;
+	}
+	litelogger::logln(litelogger::INFO, "Packed %zu files, %llu KiB -> %llu KiB", packed.size(),
+		(unsigned long long) (size >> 10), (unsigned long long) (storedSize >> 10)
+	);
+	return EXIT_SUCCESS;
+}
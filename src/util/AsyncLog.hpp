@@ -0,0 +1,328 @@
+#ifndef ASYNCLOG_HPP
+#define ASYNCLOG_HPP
+
+#include <litelogger.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/// Asynchronous backend for litelogger.
+/// `log`/`logln` copy the format pointer, the arguments and a timestamp into a lock-free ring owned by
+/// the calling thread, a background thread does the formatting and I/O. When a ring is full the message
+/// is dropped instead of waiting, the number of dropped messages is reported once there's room again.
+/// Messages are ordered per thread only. Before `start` and after `stop` everything prints synchronously.
+///
+/// Formats have to outlive the message (string literals), `%s` arguments are copied into the record
+/// and truncated to whatever space is left in it.
+namespace asynclog {
+	constexpr size_t ARGS_SIZE = 464; // a record is 512 bytes
+	constexpr size_t RING_CAPACITY = 256; // records per thread
+	constexpr size_t MAX_THREADS = 64; // threads past this log synchronously
+
+	struct Record {
+		const litelogger::Logger *logger;
+		const char *format;
+		time_t time;
+		void (*print)(FILE *stream, const char *format, const unsigned char *args);
+		bool newline;
+		alignas(16) unsigned char args[ARGS_SIZE];
+	};
+
+	/// single producer (the owning thread), single consumer (whoever holds `Backend::drainMutex`)
+	struct Ring {
+		Record records[RING_CAPACITY];
+
+		alignas(64) std::atomic<size_t> head{0}; // written by the owning thread
+		alignas(64) std::atomic<size_t> tail{0}; // written by the consumer
+		std::atomic<uint64_t> dropped{0};
+	};
+
+	struct Backend {
+		std::atomic<Ring*> rings[MAX_THREADS] = {};
+		std::atomic<size_t> ringCount{0};
+
+		std::atomic<bool> running{false};
+		std::thread thread;
+		std::mutex drainMutex;
+
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		std::atomic<bool> sleeping{false}; // the log thread is waiting on `wake`, producers only notify then
+		bool handlersInstalled = false;
+	};
+	inline Backend backend;
+
+	namespace detail {
+		/// how an argument is kept in a record. strings are copied since they may not outlive the call
+		template<typename T>
+		struct Stored {
+			typedef T type;
+
+			static T store(T value, unsigned char *, size_t &) {
+				return value;
+			}
+			static T load(T value, const unsigned char *) {
+				return value;
+			}
+		};
+		struct StringOffset {
+			uint16_t offset;
+		};
+		template<>
+		struct Stored<const char*> {
+			typedef StringOffset type;
+
+			static StringOffset store(const char *value, unsigned char *args, size_t &used) {
+				if(used >= ARGS_SIZE - 1)
+					return {ARGS_SIZE - 1}; // out of space, points at the terminating zero
+				if(!value)
+					value = "(null)";
+
+				size_t length = std::min(strlen(value), ARGS_SIZE - 1 - used);
+				StringOffset offset = {(uint16_t) used};
+				memcpy(args + used, value, length);
+				args[used + length] = '\0';
+				used += length + 1;
+				return offset;
+			}
+			static const char *load(StringOffset value, const unsigned char *args) {
+				return (const char *) args + value.offset;
+			}
+		};
+		template<>
+		struct Stored<char*>: Stored<const char*> {};
+
+		template<typename... Args>
+		using StoredTuple = std::tuple<typename Stored<Args>::type...>;
+
+		template<typename... Args, size_t... I>
+		void printValues(FILE *stream, const char *format, const unsigned char *args, std::index_sequence<I...>) {
+			const StoredTuple<Args...> &values = *reinterpret_cast<const StoredTuple<Args...>*>(args);
+			fprintf(stream, format, Stored<Args>::load(std::get<I>(values), args)...);
+		}
+		template<typename... Args>
+		void printRecord(FILE *stream, const char *format, const unsigned char *args) {
+			printValues<Args...>(stream, format, args, std::index_sequence_for<Args...>());
+		}
+
+		template<typename... Args>
+		void pack(unsigned char *args, Args... values) {
+			static_assert(sizeof(StoredTuple<Args...>) < ARGS_SIZE, "too many log arguments");
+			static_assert(std::is_trivially_destructible<StoredTuple<Args...>>::value, "log arguments have to be trivial");
+
+			size_t used = sizeof(StoredTuple<Args...>);
+			new (args) StoredTuple<Args...>(Stored<Args>::store(values, args, used)...);
+			(void) used; // unused without string arguments
+		}
+
+		inline Ring *registerRing() {
+			size_t index = backend.ringCount.fetch_add(1, std::memory_order_relaxed);
+			if(index >= MAX_THREADS)
+				return nullptr;
+
+			// owned by the backend from now on, rings outlive their threads so late messages still get written
+			Ring *ring = new Ring();
+			backend.rings[index].store(ring, std::memory_order_release);
+			return ring;
+		}
+		inline Ring *threadRing() {
+			thread_local Ring *ring = registerRing();
+			return ring;
+		}
+
+		inline void write(const Record &record) {
+			// only ever called with `drainMutex` held
+			static time_t cachedTime = -1;
+			static char timeString[9];
+			if(record.time != cachedTime) {
+				cachedTime = record.time;
+				strftime(timeString, 9, "%H:%M:%S", localtime(&cachedTime));
+			}
+
+			FILE *stream = record.logger->stream;
+			fprintf(stream, record.logger->format, record.logger->name, timeString);
+			record.print(stream, record.format, record.args);
+			if(record.newline)
+				putc('\n', stream);
+		}
+		/// write everything currently queued, `drainMutex` has to be held. returns false if there was nothing
+		inline bool drain() {
+			bool wrote = false;
+
+			size_t count = std::min(backend.ringCount.load(std::memory_order_acquire), MAX_THREADS);
+			for(size_t i = 0; i < count; i++) {
+				Ring *ring = backend.rings[i].load(std::memory_order_acquire);
+				if(!ring) // registered but not published yet
+					continue;
+
+				size_t tail = ring->tail.load(std::memory_order_relaxed);
+				size_t head = ring->head.load(std::memory_order_acquire);
+				for(; tail != head; tail++) {
+					write(ring->records[tail % RING_CAPACITY]);
+					wrote = true;
+				}
+				ring->tail.store(tail, std::memory_order_release);
+
+				uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+				if(dropped > 0) {
+					litelogger::logln(litelogger::WARN, "%llu log messages were dropped, the log thread couldn't keep up", (unsigned long long) dropped);
+					wrote = true;
+				}
+			}
+			if(wrote)
+				fflush(nullptr);
+			return wrote;
+		}
+
+		/// true if any ring has records that weren't written yet
+		inline bool pending() {
+			size_t count = std::min(backend.ringCount.load(std::memory_order_acquire), MAX_THREADS);
+			for(size_t i = 0; i < count; i++) {
+				Ring *ring = backend.rings[i].load(std::memory_order_acquire);
+				if(ring && ring->head.load(std::memory_order_acquire) != ring->tail.load(std::memory_order_relaxed))
+					return true;
+			}
+			return false;
+		}
+
+		inline void run() {
+			while(backend.running.load(std::memory_order_acquire)) {
+				bool wrote;
+				{
+					std::lock_guard<std::mutex> lock(backend.drainMutex);
+					wrote = drain();
+				}
+				if(wrote)
+					continue;
+
+				// sleep until a producer sees `sleeping`, so logging only costs a syscall when this thread is idle.
+				// the fence pairs with the one in `push`, either the record is seen here or `sleeping` is seen there
+				std::unique_lock<std::mutex> lock(backend.wakeMutex);
+				backend.sleeping.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if(!pending() && backend.running.load(std::memory_order_acquire))
+					backend.wake.wait(lock);
+				backend.sleeping.store(false, std::memory_order_relaxed);
+			}
+		}
+		inline void notify() {
+			// taking the mutex makes sure the log thread is either waiting already or hasn't checked for records yet
+			{
+				std::lock_guard<std::mutex> lock(backend.wakeMutex);
+			}
+			backend.wake.notify_one();
+		}
+
+		inline void crashHandler(int signal) {
+			// best effort: the crashing thread might be the one draining, so don't wait on it forever
+			bool locked = false;
+			for(int i = 0; i < 100 && !(locked = backend.drainMutex.try_lock()); i++)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			if(locked) {
+				drain();
+				backend.drainMutex.unlock();
+			}
+
+			std::signal(signal, SIG_DFL);
+			std::raise(signal);
+		}
+
+		template<typename... Args>
+		void push(const litelogger::Logger &logger, bool newline, const char *format, Args... args) {
+			if(logger.level < litelogger::logLevel)
+				return;
+
+			Ring *ring = backend.running.load(std::memory_order_acquire) ? threadRing() : nullptr;
+			if(!ring) {
+				if(newline)
+					litelogger::logln(logger, format, args...);
+				else
+					litelogger::log(logger, format, args...);
+				return;
+			}
+
+			size_t head = ring->head.load(std::memory_order_relaxed);
+			if(head - ring->tail.load(std::memory_order_acquire) == RING_CAPACITY) {
+				ring->dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			Record &record = ring->records[head % RING_CAPACITY];
+			record.logger = &logger;
+			record.format = format;
+			record.time = time(nullptr);
+			record.print = &printRecord<std::decay_t<Args>...>;
+			record.newline = newline;
+			pack<std::decay_t<Args>...>(record.args, args...);
+
+			ring->head.store(head + 1, std::memory_order_release);
+
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(backend.sleeping.load(std::memory_order_relaxed))
+				notify();
+		}
+	}
+
+	/// blocks until everything logged so far has been written
+	inline void flush() {
+		std::lock_guard<std::mutex> lock(backend.drainMutex);
+		detail::drain();
+	}
+
+	/// stop the log thread and write whatever is left. called automatically at exit
+	inline void stop() {
+		if(!backend.running.exchange(false))
+			return;
+
+		detail::notify();
+		backend.thread.join();
+		flush();
+	}
+	/// start the log thread, also flushes the queue on exit and on fatal signals
+	inline void start() {
+		if(backend.running.exchange(true))
+			return;
+
+		backend.thread = std::thread(detail::run);
+
+		if(!backend.handlersInstalled) {
+			backend.handlersInstalled = true;
+			atexit(stop);
+			for(int signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL, SIGBUS})
+				std::signal(signal, detail::crashHandler);
+		}
+	}
+
+	/// print with no newline
+	template<typename... Args>
+	void log(const litelogger::Logger &logger, const char *format, Args... args) {
+		detail::push(logger, false, format, args...);
+	}
+	/// print with a newline added automatically
+	template<typename... Args>
+	void logln(const litelogger::Logger &logger, const char *format, Args... args) {
+		detail::push(logger, true, format, args...);
+	}
+
+	/// writes out everything queued so far, then prints to the error logger and exits the program
+	template<typename... Args>
+	void exitError(const char *format, Args... args) {
+		flush();
+		// not forwarded to `litelogger::exitError`, that one passes its `va_list` on as a single variadic argument
+		litelogger::logln(litelogger::ERROR, format, args...);
+		exit(EXIT_FAILURE);
+	}
+}
+
+#endif //ASYNCLOG_HPP
@@ -0,0 +1,60 @@
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <deque>
+
+/// Blocking single producer/consumer handoff with a fixed capacity.
+/// `push` waits while the queue is full, `pop` waits while it's empty; `close` wakes both up for good.
+template<typename T>
+struct BoundedQueue {
+	size_t capacity;
+
+	std::deque<T> queue;
+	std::mutex mutex;
+	std::condition_variable notFull, notEmpty;
+	bool closed;
+
+	explicit BoundedQueue(size_t capacity): capacity(capacity), closed(false) {}
+
+	/// returns false (and drops `value`) if the queue was closed
+	bool push(T &&value) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [&]() {
+			return closed || queue.size() < capacity;
+		});
+		if(closed)
+			return false;
+
+		queue.push_back(std::move(value));
+		lock.unlock();
+		notEmpty.notify_one();
+		return true;
+	}
+	/// returns false once the queue is closed and drained
+	bool pop(T &value) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [&]() {
+			return closed || !queue.empty();
+		});
+		if(queue.empty())
+			return false;
+
+		value = std::move(queue.front());
+		queue.pop_front();
+		lock.unlock();
+		notFull.notify_one();
+		return true;
+	}
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+};
+
+#endif //BOUNDEDQUEUE_HPP
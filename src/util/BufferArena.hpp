@@ -0,0 +1,85 @@
+#ifndef BUFFERARENA_HPP
+#define BUFFERARENA_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <util/AsyncLog.hpp>
+
+#include <util/TlsfAllocator.hpp>
+
+#include <cstring>
+#include <tuple>
+
+/// One big VMA buffer carved into variable sized ranges by a `TlsfAllocator`.
+/// Everything living in an arena can be bound with a single buffer handle and an offset.
+struct BufferArena {
+	struct Range {
+		vk::DeviceSize offset;
+		vk::DeviceSize size;
+		TlsfAllocator::Allocation allocation;
+
+		bool valid() const {
+			return allocation.valid();
+		}
+	};
+
+	const char *name;
+
+	vk::Buffer buffer;
+	vma::Allocation allocation;
+	void *mapped; // persistently mapped, `nullptr` if the memory isn't host visible
+
+	TlsfAllocator tlsf;
+
+	BufferArena(): name("Unnamed arena"), mapped(nullptr) {}
+
+	void create(vma::Allocator allocator, const char *name, vk::DeviceSize size, vk::BufferUsageFlags usage, const vma::AllocationCreateInfo &allocationCreateInfo) {
+		this->name = name;
+
+		std::tie(buffer, allocation) = allocator.createBuffer(
+			vk::BufferCreateInfo(vk::BufferCreateFlags(), size, usage),
+			allocationCreateInfo
+		);
+
+		mapped = nullptr;
+		if(allocator.getMemoryTypeProperties(allocator.getAllocationInfo(allocation).memoryType) & vk::MemoryPropertyFlagBits::eHostVisible)
+			allocator.mapMemory(allocation, &mapped);
+
+		tlsf.init(size);
+	}
+	void destroy(vma::Allocator allocator) {
+		if(mapped)
+			allocator.unmapMemory(allocation);
+		allocator.destroyBuffer(buffer, allocation);
+		mapped = nullptr;
+	}
+
+	Range allocate(vk::DeviceSize size, vk::DeviceSize alignment = 1) {
+		TlsfAllocator::Allocation a = tlsf.allocate(size, alignment);
+		if(!a.valid())
+			asynclog::exitError("%s is out of space (%llu bytes requested) :(", name, (unsigned long long) size);
+		return {a.offset, a.size, a};
+	}
+	void free(const Range &range) {
+		tlsf.free(range.allocation);
+	}
+
+	/// copy `size` bytes into `range` starting at `offset` bytes into the range
+	void write(const Range &range, const void *data, vk::DeviceSize size, vk::DeviceSize offset = 0) {
+		if(!mapped)
+			asynclog::exitError("%s isn't host visible, can't write to it directly :(", name);
+		memcpy(static_cast<uint8_t*>(mapped) + range.offset + offset, data, size);
+	}
+
+	void logStats(const litelogger::Logger &logger) const {
+		TlsfAllocator::Stats s = tlsf.stats();
+		asynclog::logln(logger, "%s: %llu/%llu bytes used in %u ranges, %u free blocks (largest %llu bytes), fragmentation %.1f%%",
+			name,
+			(unsigned long long) s.usedSize, (unsigned long long) s.size,
+			s.allocationCount, s.freeBlockCount, (unsigned long long) s.largestFreeBlock,
+			s.fragmentation() * 100.0f
+		);
+	}
+};
+
+#endif //BUFFERARENA_HPP
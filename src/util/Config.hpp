@@ -0,0 +1,25 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <cstdlib>
+#include <cstring>
+
+/// Runtime settings, read from `VKENGINE_*` environment variables
+namespace config {
+	/// value of `name`, or `fallback` if it isn't set
+	inline const char *get(const char *name, const char *fallback) {
+		const char *value = getenv(name);
+		return value && *value ? value : fallback;
+	}
+	/// true if `name` is set to `value`
+	inline bool is(const char *name, const char *value) {
+		const char *v = getenv(name);
+		return v && strcmp(v, value) == 0;
+	}
+	inline long getInt(const char *name, long fallback) {
+		const char *value = getenv(name);
+		return value && *value ? strtol(value, nullptr, 10) : fallback;
+	}
+}
+
+#endif //CONFIG_HPP
@@ -3,11 +3,14 @@
 
 #include <functional>
 #include <deque>
+#include <mutex>
 
 struct DeletionQueue {
 	std::deque<std::function<void()>> queue;
+	std::mutex mutex; // startup stages push from several threads
 
 	void push(std::function<void()>&& function) {
+		std::lock_guard<std::mutex> lock(mutex);
 		queue.push_back(function);
 	}
 	void clear() {
@@ -0,0 +1,159 @@
+#ifndef LZ4_HPP
+#define LZ4_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/// Minimal LZ4 block format codec. The compressor is a plain greedy single-probe one, good enough for
+/// packing assets offline; the decompressor checks every length and offset against both buffers.
+namespace lz4 {
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t LAST_LITERALS = 5; // the last 5 bytes are always literals
+	constexpr size_t MF_LIMIT = 12; // the last match has to start at least 12 bytes before the end
+	constexpr uint32_t HASH_LOG = 16;
+
+	inline size_t compressBound(size_t size) {
+		return size + size / 255 + 16;
+	}
+
+	namespace detail {
+		inline uint32_t read32(const uint8_t *p) {
+			uint32_t v;
+			memcpy(&v, p, 4);
+			return v;
+		}
+		inline uint32_t hash(uint32_t sequence) {
+			return (sequence * 2654435761u) >> (32 - HASH_LOG);
+		}
+		inline uint8_t *writeLength(uint8_t *op, size_t length) {
+			for(; length >= 255; length -= 255)
+				*op++ = 255;
+			*op++ = (uint8_t) length;
+			return op;
+		}
+		inline uint8_t *writeSequence(uint8_t *op, const uint8_t *literals, size_t literalLength, size_t offset, size_t matchLength) {
+			uint8_t *token = op++;
+			*token = (uint8_t) ((literalLength >= 15 ? 15 : literalLength) << 4);
+			if(literalLength >= 15)
+				op = writeLength(op, literalLength - 15);
+			if(literalLength > 0)
+				memcpy(op, literals, literalLength);
+			op += literalLength;
+
+			if(matchLength == 0) // last sequence, no match
+				return op;
+
+			*op++ = (uint8_t) offset;
+			*op++ = (uint8_t) (offset >> 8);
+			matchLength -= MIN_MATCH;
+			*token |= matchLength >= 15 ? 15 : matchLength;
+			if(matchLength >= 15)
+				op = writeLength(op, matchLength - 15);
+			return op;
+		}
+	}
+
+	/// `dst` has to hold `compressBound(srcSize)` bytes. returns the compressed size
+	inline size_t compress(const uint8_t *src, size_t srcSize, uint8_t *dst) {
+		const uint8_t *ip = src, *anchor = src, *end = src + srcSize;
+		uint8_t *op = dst;
+
+		if(srcSize > MF_LIMIT) {
+			std::vector<uint32_t> table(1 << HASH_LOG, UINT32_MAX);
+			const uint8_t *matchLimit = end - LAST_LITERALS;
+			const uint8_t *mfLimit = end - MF_LIMIT;
+
+			while(ip <= mfLimit) {
+				uint32_t sequence = detail::read32(ip);
+				uint32_t &slot = table[detail::hash(sequence)];
+				uint32_t candidate = slot;
+				slot = ip - src;
+
+				if(candidate == UINT32_MAX || ip - (src + candidate) > 65535 || detail::read32(src + candidate) != sequence) {
+					ip++;
+					continue;
+				}
+
+				const uint8_t *match = src + candidate;
+				while(ip > anchor && match > src && ip[-1] == match[-1]) {
+					ip--;
+					match--;
+				}
+				size_t length = MIN_MATCH;
+				while(ip + length < matchLimit && ip[length] == match[length])
+					length++;
+
+				op = detail::writeSequence(op, anchor, ip - anchor, ip - match, length);
+				ip += length;
+				anchor = ip;
+			}
+		}
+
+		op = detail::writeSequence(op, anchor, end - anchor, 0, 0);
+		return op - dst;
+	}
+
+	/// false if `src` isn't a valid block that decodes to exactly `dstSize` bytes
+	inline bool decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize) {
+		const uint8_t *ip = src, *iend = src + srcSize;
+		uint8_t *op = dst, *oend = dst + dstSize;
+
+		while(ip < iend) {
+			uint8_t token = *ip++;
+
+			size_t literalLength = token >> 4;
+			if(literalLength == 15) {
+				uint8_t b;
+				do {
+					if(ip >= iend)
+						return false;
+					b = *ip++;
+					literalLength += b;
+				} while(b == 255);
+			}
+			if(literalLength > (size_t) (iend - ip) || literalLength > (size_t) (oend - op))
+				return false;
+			if(literalLength > 0)
+				memcpy(op, ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+
+			if(ip == iend) // the last sequence ends after its literals
+				break;
+
+			if(iend - ip < 2)
+				return false;
+			size_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if(offset == 0 || offset > (size_t) (op - dst))
+				return false;
+
+			size_t matchLength = token & 15;
+			if(matchLength == 15) {
+				uint8_t b;
+				do {
+					if(ip >= iend)
+						return false;
+					b = *ip++;
+					matchLength += b;
+				} while(b == 255);
+			}
+			matchLength += MIN_MATCH;
+			if(matchLength > (size_t) (oend - op))
+				return false;
+
+			const uint8_t *match = op - offset;
+			if(offset >= matchLength) {
+				memcpy(op, match, matchLength);
+			} else {
+				for(size_t i = 0; i < matchLength; i++) // overlapping, repeats the last `offset` bytes
+					op[i] = match[i];
+			}
+			op += matchLength;
+		}
+		return op == oend;
+	}
+}
+
+#endif //LZ4_HPP
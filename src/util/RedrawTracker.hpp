@@ -0,0 +1,47 @@
+#ifndef REDRAWTRACKER_HPP
+#define REDRAWTRACKER_HPP
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstdint>
+
+/// Collects "needs redraw" requests from subsystems for on-demand rendering.
+/// `request` may be called from any thread, it also wakes the main thread out of `glfwWaitEvents`.
+struct RedrawTracker {
+	enum Subsystem : uint32_t {
+		INPUT = 1 << 0,
+		WINDOW = 1 << 1,
+		ANIMATION = 1 << 2,
+		RESOURCES = 1 << 3,
+		SCENE = 1 << 4
+	};
+
+	std::atomic<uint32_t> dirty{0};
+	std::atomic<uint32_t> continuous{0}; // subsystems that want a redraw every frame, e.g. running animations
+
+	/// ask for (at least) one more frame
+	void request(uint32_t subsystems) {
+		if(dirty.fetch_or(subsystems) == 0)
+			glfwPostEmptyEvent();
+	}
+	/// keep redrawing every frame while `enabled`
+	void setContinuous(uint32_t subsystems, bool enabled) {
+		if(enabled) {
+			if(continuous.fetch_or(subsystems) == 0)
+				glfwPostEmptyEvent();
+		} else {
+			continuous.fetch_and(~subsystems);
+		}
+	}
+
+	bool pending() const {
+		return (dirty.load() | continuous.load()) != 0;
+	}
+	/// returns the subsystems that asked for this frame and clears one-off requests
+	uint32_t consume() {
+		return dirty.exchange(0) | continuous.load();
+	}
+};
+
+#endif //REDRAWTRACKER_HPP
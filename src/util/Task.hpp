@@ -0,0 +1,174 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/// Lazily started coroutine producing a `T`. Nothing runs until the task is `co_await`ed (or handed to
+/// `spawn`/`syncWait`); when it finishes the awaiting coroutine is resumed right away on the same thread.
+/// Which thread that is depends on what the task awaited last, e.g. `AssetLoader::resumeOnWorker`.
+template<typename T = void>
+class Task;
+
+namespace detail {
+	struct FinalAwaiter {
+		bool await_ready() noexcept {
+			return false;
+		}
+		template<typename P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+			std::coroutine_handle<> continuation = handle.promise().continuation;
+			return continuation ? continuation : std::noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+
+	struct PromiseBase {
+		std::coroutine_handle<> continuation;
+
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+		FinalAwaiter final_suspend() noexcept {
+			return {};
+		}
+		void unhandled_exception() {
+			std::terminate();
+		}
+	};
+	template<typename T>
+	struct Promise: PromiseBase {
+		std::optional<T> value;
+
+		Task<T> get_return_object();
+		void return_value(T v) {
+			value.emplace(std::move(v));
+		}
+		T result() {
+			return std::move(*value);
+		}
+	};
+	template<>
+	struct Promise<void>: PromiseBase {
+		Task<void> get_return_object();
+		void return_void() {}
+		void result() {}
+	};
+
+	/// starts right away and frees itself when done, used to drive a `Task` from non-coroutine code
+	struct Detached {
+		struct promise_type {
+			Detached get_return_object() {
+				return {};
+			}
+			std::suspend_never initial_suspend() noexcept {
+				return {};
+			}
+			std::suspend_never final_suspend() noexcept {
+				return {};
+			}
+			void return_void() {}
+			void unhandled_exception() {
+				std::terminate();
+			}
+		};
+	};
+}
+
+template<typename T>
+class Task {
+public:
+	typedef detail::Promise<T> promise_type;
+	typedef std::coroutine_handle<promise_type> Handle;
+protected:
+	Handle handle;
+public:
+	explicit Task(Handle handle): handle(handle) {}
+	Task(Task &&other) noexcept: handle(std::exchange(other.handle, nullptr)) {}
+	Task &operator=(Task &&other) noexcept {
+		if(this != &other) {
+			if(handle)
+				handle.destroy();
+			handle = std::exchange(other.handle, nullptr);
+		}
+		return *this;
+	}
+	Task(const Task&) = delete;
+	Task &operator=(const Task&) = delete;
+	~Task() {
+		if(handle)
+			handle.destroy();
+	}
+
+	bool await_ready() const noexcept {
+		return false;
+	}
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+		handle.promise().continuation = awaiting;
+		return handle; // symmetric transfer, no stack growth for long chains
+	}
+	T await_resume() {
+		return handle.promise().result();
+	}
+};
+
+namespace detail {
+	template<typename T>
+	Task<T> Promise<T>::get_return_object() {
+		return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+	}
+	inline Task<void> Promise<void>::get_return_object() {
+		return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+	}
+}
+
+/// run `task` to completion in the background, nobody waits for it
+inline void spawn(Task<void> &&task) {
+	[](Task<void> task) -> detail::Detached {
+		co_await task;
+	}(std::move(task));
+}
+
+namespace detail {
+	template<typename T>
+	struct SyncWaitState {
+		std::mutex mutex;
+		std::condition_variable finished;
+		bool done = false;
+		std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> result;
+	};
+	template<typename T>
+	Detached syncWaitRun(Task<T> *task, SyncWaitState<T> *state) {
+		if constexpr(std::is_void_v<T>) {
+			co_await *task;
+			state->result.emplace(true);
+		} else {
+			state->result.emplace(co_await *task);
+		}
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->done = true;
+		state->finished.notify_one();
+	}
+}
+
+/// start `task` and block the calling thread until it's done. only meant for bridging into code that
+/// isn't a coroutine itself, like startup stages
+template<typename T>
+T syncWait(Task<T> &&task) {
+	detail::SyncWaitState<T> state;
+	detail::syncWaitRun(&task, &state);
+
+	std::unique_lock<std::mutex> lock(state.mutex);
+	state.finished.wait(lock, [&]() {
+		return state.done;
+	});
+	if constexpr(!std::is_void_v<T>)
+		return std::move(*state.result);
+}
+
+#endif //TASK_HPP
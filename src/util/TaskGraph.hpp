@@ -0,0 +1,113 @@
+#ifndef TASKGRAPH_HPP
+#define TASKGRAPH_HPP
+
+#include <util/AsyncLog.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Runs named tasks on a few threads, each as soon as everything it depends on is done, and records
+/// when and where each one ran. Tasks can only depend on tasks added before them, so there are no cycles.
+/// `mainThread` tasks only run on the thread calling `run`, for things like GLFW's window functions.
+struct TaskGraph {
+	typedef uint32_t TaskHandle;
+	typedef std::chrono::steady_clock Clock;
+
+	struct Task {
+		const char *name;
+		std::function<void()> function;
+		bool mainThread;
+
+		std::vector<TaskHandle> dependents;
+		uint32_t dependencyCount;
+		uint32_t remaining; // dependencies not done yet
+
+		Clock::time_point start, end;
+		uint32_t thread; // 0 is the thread that called `run`
+	};
+
+	std::vector<Task> tasks;
+	Clock::time_point start, end;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<TaskHandle> ready, readyMain;
+	size_t done;
+
+	TaskHandle add(const char *name, std::function<void()> &&function, std::initializer_list<TaskHandle> dependencies = {}, bool mainThread = false) {
+		TaskHandle handle = tasks.size();
+		tasks.push_back({name, std::move(function), mainThread, {}, (uint32_t) dependencies.size(), 0, {}, {}, 0});
+		for(TaskHandle d : dependencies)
+			tasks[d].dependents.push_back(handle);
+		return handle;
+	}
+
+	/// runs every task and returns once they're all done. with `workerCount` 0 everything runs on this thread
+	void run(uint32_t workerCount) {
+		start = Clock::now();
+		done = 0;
+		ready.clear();
+		readyMain.clear();
+		for(TaskHandle t = 0; t < tasks.size(); t++) {
+			tasks[t].remaining = tasks[t].dependencyCount;
+			if(tasks[t].remaining == 0)
+				(tasks[t].mainThread ? readyMain : ready).push_back(t);
+		}
+
+		std::vector<std::thread> workers;
+		for(uint32_t i = 1; i <= workerCount; i++)
+			workers.emplace_back(&TaskGraph::work, this, i);
+		work(0);
+		for(std::thread &w : workers)
+			w.join();
+
+		end = Clock::now();
+	}
+
+	void logTimings(const litelogger::Logger &logger, const char *name) const {
+		double work = 0.0;
+		for(const Task &t : tasks) {
+			double offset = std::chrono::duration<double, std::milli>(t.start - start).count();
+			double duration = std::chrono::duration<double, std::milli>(t.end - t.start).count();
+			work += duration;
+			asynclog::logln(logger, "  %-20s %8.2f ms, started at %8.2f ms on thread %u", t.name, duration, offset, t.thread);
+		}
+		asynclog::logln(logger, "%s took %.2f ms (%.2f ms of work)", name, std::chrono::duration<double, std::milli>(end - start).count(), work);
+	}
+protected:
+	void work(uint32_t thread) {
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true) {
+			changed.wait(lock, [&]() {
+				return done == tasks.size() || !ready.empty() || (thread == 0 && !readyMain.empty());
+			});
+			if(done == tasks.size())
+				return;
+
+			std::deque<TaskHandle> &queue = thread == 0 && !readyMain.empty() ? readyMain : ready;
+			Task &task = tasks[queue.front()];
+			queue.pop_front();
+
+			lock.unlock();
+			task.thread = thread;
+			task.start = Clock::now();
+			task.function();
+			task.end = Clock::now();
+			lock.lock();
+
+			for(TaskHandle d : task.dependents)
+				if(--tasks[d].remaining == 0)
+					(tasks[d].mainThread ? readyMain : ready).push_back(d);
+			done++;
+			changed.notify_all();
+		}
+	}
+};
+
+#endif //TASKGRAPH_HPP
@@ -0,0 +1,62 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Long lived worker threads running posted jobs in FIFO order.
+struct ThreadPool {
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobsChanged;
+	bool stopping;
+
+	void create(uint32_t threadCount) {
+		stopping = false;
+		for(uint32_t i = 0; i < threadCount; i++)
+			threads.emplace_back(&ThreadPool::work, this);
+	}
+	/// runs whatever is still queued, then joins the workers
+	void destroy() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		jobsChanged.notify_all();
+		for(std::thread &t : threads)
+			t.join();
+		threads.clear();
+	}
+
+	void post(std::function<void()> &&job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+		}
+		jobsChanged.notify_one();
+	}
+protected:
+	void work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true) {
+			jobsChanged.wait(lock, [&]() {
+				return stopping || !jobs.empty();
+			});
+			if(jobs.empty())
+				return;
+
+			std::function<void()> job = std::move(jobs.front());
+			jobs.pop_front();
+			lock.unlock();
+			job();
+			lock.lock();
+		}
+	}
+};
+
+#endif //THREADPOOL_HPP
@@ -0,0 +1,297 @@
+#ifndef TLSFALLOCATOR_HPP
+#define TLSFALLOCATOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+/// Two-level segregated fit allocator over an abstract range of `size` units.
+/// It never touches memory itself, it only hands out offsets, so it can carve up
+/// anything (usually one big `vk::Buffer`). Both `allocate` and `free` are O(1).
+struct TlsfAllocator {
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	static constexpr uint32_t SL_LOG2 = 4; // 16 second level lists per first level
+	static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+	static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+
+	struct Allocation {
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t block = NONE; // `NONE` if the allocation failed
+
+		bool valid() const {
+			return block != NONE;
+		}
+	};
+	struct Stats {
+		uint64_t size;
+		uint64_t usedSize;
+		uint64_t freeSize;
+		uint64_t largestFreeBlock;
+		uint32_t allocationCount;
+		uint32_t freeBlockCount;
+
+		/// 0 when all free space is one contiguous block, approaches 1 the more it is scattered
+		float fragmentation() const {
+			return freeSize == 0 ? 0.0f : 1.0f - (float) largestFreeBlock / (float) freeSize;
+		}
+	};
+
+	struct Block {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prevPhysical, nextPhysical;
+		uint32_t prevFree, nextFree; // also links unused entries of `blocks` together
+		bool free;
+	};
+
+	std::vector<Block> blocks;
+	uint32_t unusedBlocks = NONE;
+
+	uint64_t flBitmap = 0;
+	uint32_t slBitmaps[FL_COUNT] = {};
+	uint32_t freeLists[FL_COUNT][SL_COUNT];
+
+	uint64_t size = 0;
+	uint64_t usedSize = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeBlockCount = 0;
+
+	TlsfAllocator() {
+		for(auto &fl : freeLists)
+			for(uint32_t &sl : fl)
+				sl = NONE;
+	}
+	explicit TlsfAllocator(uint64_t size): TlsfAllocator() {
+		init(size);
+	}
+
+	void init(uint64_t size) {
+		this->size = size;
+		usedSize = 0;
+		allocationCount = 0;
+		freeBlockCount = 0;
+		flBitmap = 0;
+		for(uint32_t fl = 0; fl < FL_COUNT; fl++) {
+			slBitmaps[fl] = 0;
+			for(uint32_t sl = 0; sl < SL_COUNT; sl++)
+				freeLists[fl][sl] = NONE;
+		}
+		blocks.clear();
+		unusedBlocks = NONE;
+
+		if(size == 0)
+			return;
+
+		uint32_t b = newBlock();
+		blocks[b] = {0, size, NONE, NONE, NONE, NONE, true};
+		insertFree(b);
+	}
+
+	/// `alignment` may be any non-zero value, not just powers of two (e.g. `sizeof(Vertex)`)
+	Allocation allocate(uint64_t allocationSize, uint64_t alignment = 1) {
+		if(allocationSize == 0 || alignment == 0)
+			return {};
+
+		uint64_t searchSize = allocationSize + alignment - 1;
+		if(searchSize < allocationSize) // overflow
+			return {};
+
+		uint32_t b = findFree(searchSize);
+		if(b == NONE)
+			return {};
+		removeFree(b);
+		return take(b, allocationSize, alignment);
+	}
+	/// like `allocate`, but from the free block closest to the start. O(blocks), meant for compacting
+	Allocation allocateFront(uint64_t allocationSize, uint64_t alignment = 1) {
+		if(allocationSize == 0 || alignment == 0)
+			return {};
+
+		for(uint32_t b = blocks.empty() ? NONE : 0; b != NONE; b = blocks[b].nextPhysical) {
+			if(!blocks[b].free)
+				continue;
+			uint64_t alignedOffset = (blocks[b].offset + alignment - 1) / alignment * alignment;
+			if(alignedOffset + allocationSize <= blocks[b].offset + blocks[b].size) {
+				removeFree(b);
+				return take(b, allocationSize, alignment);
+			}
+		}
+		return {};
+	}
+	void free(const Allocation &allocation) {
+		if(!allocation.valid())
+			return;
+
+		uint32_t b = allocation.block;
+		usedSize -= blocks[b].size;
+		allocationCount--;
+		blocks[b].free = true;
+
+		uint32_t prev = blocks[b].prevPhysical;
+		if(prev != NONE && blocks[prev].free) {
+			removeFree(prev);
+			b = merge(prev, b);
+		}
+		uint32_t next = blocks[b].nextPhysical;
+		if(next != NONE && blocks[next].free) {
+			removeFree(next);
+			b = merge(b, next);
+		}
+		insertFree(b);
+	}
+
+	Stats stats() const {
+		Stats s{size, usedSize, size - usedSize, 0, allocationCount, freeBlockCount};
+
+		// the highest non-empty list holds the biggest blocks, only that one needs walking
+		if(flBitmap != 0) {
+			uint32_t fl = 63 - __builtin_clzll(flBitmap);
+			uint32_t sl = 31 - __builtin_clz(slBitmaps[fl]);
+			for(uint32_t b = freeLists[fl][sl]; b != NONE; b = blocks[b].nextFree)
+				if(blocks[b].size > s.largestFreeBlock)
+					s.largestFreeBlock = blocks[b].size;
+		}
+		return s;
+	}
+
+	/// every live allocation, ordered by offset
+	std::vector<Allocation> allocations() const {
+		std::vector<Allocation> result;
+		result.reserve(allocationCount);
+
+		// splits and merges always keep the front block, so the one `init` made stays first
+		for(uint32_t b = blocks.empty() ? NONE : 0; b != NONE; b = blocks[b].nextPhysical)
+			if(!blocks[b].free)
+				result.push_back({blocks[b].offset, blocks[b].size, b});
+		return result;
+	}
+
+protected:
+	static void mapping(uint64_t size, uint32_t &fl, uint32_t &sl) {
+		if(size < SL_COUNT) {
+			fl = 0;
+			sl = (uint32_t) size;
+		} else {
+			uint32_t msb = 63 - __builtin_clzll(size);
+			fl = msb - SL_LOG2 + 1;
+			sl = (uint32_t) (size >> (msb - SL_LOG2)) - SL_COUNT;
+		}
+	}
+	uint32_t findFree(uint64_t size) const {
+		// round up to the next list so that any block in the found list is large enough
+		if(size >= SL_COUNT) {
+			uint64_t round = (1ull << (63 - __builtin_clzll(size) - SL_LOG2)) - 1;
+			if(size + round < size)
+				return NONE;
+			size += round;
+		}
+
+		uint32_t fl, sl;
+		mapping(size, fl, sl);
+
+		uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+		if(slMap == 0) {
+			uint64_t flMap = fl + 1 < FL_COUNT ? flBitmap & (~0ull << (fl + 1)) : 0;
+			if(flMap == 0)
+				return NONE;
+			fl = __builtin_ctzll(flMap);
+			slMap = slBitmaps[fl];
+		}
+		sl = __builtin_ctz(slMap);
+		return freeLists[fl][sl];
+	}
+	void insertFree(uint32_t b) {
+		uint32_t fl, sl;
+		mapping(blocks[b].size, fl, sl);
+
+		uint32_t head = freeLists[fl][sl];
+		blocks[b].free = true;
+		blocks[b].prevFree = NONE;
+		blocks[b].nextFree = head;
+		if(head != NONE)
+			blocks[head].prevFree = b;
+		freeLists[fl][sl] = b;
+
+		slBitmaps[fl] |= 1u << sl;
+		flBitmap |= 1ull << fl;
+		freeBlockCount++;
+	}
+	void removeFree(uint32_t b) {
+		uint32_t fl, sl;
+		mapping(blocks[b].size, fl, sl);
+
+		uint32_t prev = blocks[b].prevFree, next = blocks[b].nextFree;
+		if(prev != NONE)
+			blocks[prev].nextFree = next;
+		else
+			freeLists[fl][sl] = next;
+		if(next != NONE)
+			blocks[next].prevFree = prev;
+
+		if(freeLists[fl][sl] == NONE) {
+			slBitmaps[fl] &= ~(1u << sl);
+			if(slBitmaps[fl] == 0)
+				flBitmap &= ~(1ull << fl);
+		}
+		freeBlockCount--;
+	}
+	/// carve the aligned allocation out of free block `b`, which has to be off its free list already
+	Allocation take(uint32_t b, uint64_t allocationSize, uint64_t alignment) {
+		uint64_t alignedOffset = (blocks[b].offset + alignment - 1) / alignment * alignment;
+		uint64_t padding = alignedOffset - blocks[b].offset;
+		if(padding > 0) {
+			uint32_t front = b;
+			b = split(front, padding);
+			insertFree(front);
+		}
+		if(blocks[b].size > allocationSize) {
+			uint32_t tail = split(b, allocationSize);
+			insertFree(tail);
+		}
+
+		blocks[b].free = false;
+		usedSize += blocks[b].size;
+		allocationCount++;
+
+		return {blocks[b].offset, blocks[b].size, b};
+	}
+	/// cut `b` after `size` units, returns the new block holding the remainder
+	uint32_t split(uint32_t b, uint64_t size) {
+		uint32_t rest = newBlock();
+		Block &block = blocks[b];
+
+		blocks[rest] = {block.offset + size, block.size - size, b, block.nextPhysical, NONE, NONE, true};
+		if(block.nextPhysical != NONE)
+			blocks[block.nextPhysical].prevPhysical = rest;
+		block.nextPhysical = rest;
+		block.size = size;
+
+		return rest;
+	}
+	/// fold `b` into its physical predecessor `a`, returns `a`
+	uint32_t merge(uint32_t a, uint32_t b) {
+		blocks[a].size += blocks[b].size;
+		blocks[a].nextPhysical = blocks[b].nextPhysical;
+		if(blocks[b].nextPhysical != NONE)
+			blocks[blocks[b].nextPhysical].prevPhysical = a;
+		releaseBlock(b);
+		return a;
+	}
+	uint32_t newBlock() {
+		if(unusedBlocks != NONE) {
+			uint32_t b = unusedBlocks;
+			unusedBlocks = blocks[b].nextFree;
+			return b;
+		}
+		blocks.emplace_back();
+		return blocks.size() - 1;
+	}
+	void releaseBlock(uint32_t b) {
+		blocks[b].free = false;
+		blocks[b].nextFree = unusedBlocks;
+		unusedBlocks = b;
+	}
+};
+
+#endif //TLSFALLOCATOR_HPP
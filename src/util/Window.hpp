@@ -3,7 +3,7 @@
 
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
-#include <litelogger.hpp>
+#include <util/AsyncLog.hpp>
 
 struct Window {
 	int width, height;
@@ -31,7 +31,7 @@ struct Window {
 	}
 	void createSurface(VkInstance instance) {
 		if(glfwCreateWindowSurface(instance, ptr, nullptr, reinterpret_cast<VkSurfaceKHR*>(&surface)) != VK_SUCCESS)
-			litelogger::exitError("Failed to create window surface");
+			asynclog::exitError("Failed to create window surface");
 	}
 	void destroy(vk::Instance instance) {
 		instance.destroySurfaceKHR(surface);